@@ -1,20 +1,31 @@
 #include "Dispatcher.h"
+#include <chrono>
 
-void Dispatcher::tick()
+void Dispatcher::tick(int budgetMs)
 {
 	this->executeMutex.lock();
-	for (int i = 0; i < executeQueue.size(); i++)
+	this->executeQueue.swap(this->swapQueue);
+	this->executeMutex.unlock();
+
+	// Behind whatever didn't fit into the last tick, to keep everything in order
+	for (auto& fn : this->swapQueue)
+		this->pending.push_back(std::move(fn));
+	this->swapQueue.clear();
+
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(budgetMs);
+	do
 	{
-		std::function<void()> fn = executeQueue[i];
+		if (this->pending.empty())
+			return;
+		std::function<void()> fn = std::move(this->pending.front());
+		this->pending.pop_front();
 		fn();
-	}
-	executeQueue.clear();
-	this->executeMutex.unlock();
+	} while (std::chrono::steady_clock::now() < deadline);
 }
 
 void Dispatcher::run(std::function<void()> fn)
 {
 	this->executeMutex.lock();
-	this->executeQueue.push_back(fn);
+	this->executeQueue.push_back(std::move(fn));
 	this->executeMutex.unlock();
-}
\ No newline at end of file
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include <vector>
 #include <queue>
+#include <deque>
 #include <memory>
 #include <thread>
 #include <mutex>
@@ -9,12 +10,22 @@
 #include <functional>
 #include <stdexcept>
 
+// Time the callbacks get per tick before the rest wait for the next frame, at least one always runs
+#define DISPATCHER_TICK_BUDGET_MS 2
+
+/*
+*	Runs callbacks from other threads on the main thread.
+*	run only holds the lock long enough to queue, tick swaps the whole queue out and runs it without the lock,
+*	so a worker never waits on TorqueScript and callbacks can queue more callbacks.
+*/
 class Dispatcher
 {
 	std::vector<std::function<void()>> executeQueue;
 	std::mutex executeMutex;
+	std::vector<std::function<void()>> swapQueue; // Main thread only
+	std::deque<std::function<void()>> pending; // Main thread only, left over from ticks that ran out of time
 
 public:
-	void tick();
+	void tick(int budgetMs = DISPATCHER_TICK_BUDGET_MS);
 	void run(std::function<void()> task);
-};
\ No newline at end of file
+};
@@ -0,0 +1,845 @@
+#include "FrameStore.h"
+#include <cstring>
+#include <algorithm>
+
+FrameBlock::FrameBlock()
+{
+	this->duration = 0;
+	this->thinned = false;
+}
+
+bool FrameBlock::stringEquals(Span span, const std::string& str) const
+{
+	return span.length == str.size() && (span.length == 0 || memcmp(&charPool[span.offset], str.data(), span.length) == 0);
+}
+
+FrameBlock::Span FrameBlock::storeString(const std::string& str, const std::vector<Span>& column)
+{
+	if (column.size() != 0 && stringEquals(column.back(), str))
+		return column.back();
+	return storeString(str);
+}
+
+FrameBlock::Span FrameBlock::storeString(const std::string& str)
+{
+	Span span;
+	span.offset = charPool.size();
+	span.length = str.size();
+	charPool.insert(charPool.end(), str.begin(), str.end());
+	return span;
+}
+
+std::string FrameBlock::loadString(Span span) const
+{
+	if (span.length == 0)
+		return std::string();
+	return std::string(&charPool[span.offset], span.length);
+}
+
+// Reuses out's buffer
+void FrameBlock::loadString(Span span, std::string* out) const
+{
+	if (span.length == 0)
+		out->clear();
+	else
+		out->assign(&charPool[span.offset], span.length);
+}
+
+FrameBlock::Span FrameBlock::storeInts(const std::vector<int>& list, const std::vector<Span>& column)
+{
+	if (column.size() != 0)
+	{
+		Span prev = column.back();
+		if (prev.length == list.size() && std::equal(list.begin(), list.end(), intPool.begin() + prev.offset))
+			return prev;
+	}
+	Span span;
+	span.offset = intPool.size();
+	span.length = list.size();
+	intPool.insert(intPool.end(), list.begin(), list.end());
+	return span;
+}
+
+FrameBlock::Span FrameBlock::storeFloats(const std::vector<float>& list, const std::vector<Span>& column)
+{
+	if (column.size() != 0)
+	{
+		Span prev = column.back();
+		if (prev.length == list.size() && std::equal(list.begin(), list.end(), floatPool.begin() + prev.offset))
+			return prev;
+	}
+	Span span;
+	span.offset = floatPool.size();
+	span.length = list.size();
+	floatPool.insert(floatPool.end(), list.begin(), list.end());
+	return span;
+}
+
+FrameBlock::Span FrameBlock::storeMPStates(const std::vector<MPState>& list, const std::vector<Span>& column)
+{
+	if (column.size() != 0)
+	{
+		Span prev = column.back();
+		if (prev.length == list.size())
+		{
+			bool same = true;
+			for (size_t i = 0; i < list.size() && same; i++)
+			{
+				const MPState& a = list[i];
+				const MPState& b = mpstatePool[prev.offset + i];
+				same = a.pathPosition == b.pathPosition && a.targetPosition == b.targetPosition && a.pathedInterior == b.pathedInterior;
+			}
+			if (same)
+				return prev;
+		}
+	}
+	Span span;
+	span.offset = mpstatePool.size();
+	span.length = list.size();
+	mpstatePool.insert(mpstatePool.end(), list.begin(), list.end());
+	return span;
+}
+
+template<typename T>
+FrameBlock::Span FrameBlock::storeRewindableStates(const std::vector<RewindableState<T>>& list, std::vector<StoredRewindableState<T>>& pool, const std::vector<Span>& column)
+{
+	Span prev = { 0, 0 };
+	if (column.size() != 0)
+		prev = column.back();
+
+	if (column.size() != 0 && prev.length == list.size())
+	{
+		bool same = true;
+		for (size_t i = 0; i < list.size() && same; i++)
+		{
+			const StoredRewindableState<T>& stored = pool[prev.offset + i];
+			same = stored.value == list[i].value && stored.namespaceId == list[i].namespaceId && stored.bindingIndex == list[i].bindingIndex;
+		}
+		if (same)
+			return prev;
+	}
+
+	Span span;
+	span.offset = pool.size();
+	span.length = list.size();
+	for (size_t i = 0; i < list.size(); i++)
+	{
+		StoredRewindableState<T> stored;
+		stored.value = list[i].value;
+		stored.namespaceId = list[i].namespaceId;
+		stored.bindingIndex = list[i].bindingIndex;
+		pool.push_back(stored);
+	}
+	return span;
+}
+
+FrameBlock::Span FrameBlock::storeRewindableStrings(const std::vector<RewindableState<std::string>>& list, const std::vector<Span>& column)
+{
+	Span prev = { 0, 0 };
+	if (column.size() != 0)
+		prev = column.back();
+
+	if (column.size() != 0 && prev.length == list.size())
+	{
+		bool same = true;
+		for (size_t i = 0; i < list.size() && same; i++)
+		{
+			const StoredRewindableState<Span>& stored = rewindableStringPool[prev.offset + i];
+			same = stringEquals(stored.value, list[i].value) && stored.namespaceId == list[i].namespaceId && stored.bindingIndex == list[i].bindingIndex;
+		}
+		if (same)
+			return prev;
+	}
+
+	Span span;
+	span.offset = rewindableStringPool.size();
+	span.length = list.size();
+	for (size_t i = 0; i < list.size(); i++)
+	{
+		StoredRewindableState<Span> stored;
+		stored.namespaceId = list[i].namespaceId;
+		stored.bindingIndex = list[i].bindingIndex;
+		// The value is usually the one the previous frame had at the same slot
+		if (i < prev.length && stringEquals(rewindableStringPool[prev.offset + i].value, list[i].value))
+			stored.value = rewindableStringPool[prev.offset + i].value;
+		else
+			stored.value = storeString(list[i].value);
+		rewindableStringPool.push_back(stored);
+	}
+	return span;
+}
+
+template<typename T>
+void FrameBlock::loadRewindableStates(Span span, const std::vector<StoredRewindableState<T>>& pool, std::vector<RewindableState<T>>* out) const
+{
+	// Assigns into the states out already has so a reused frame keeps its buffers, RewindableState has no default constructor to resize with
+	if (out->size() > span.length)
+		out->erase(out->begin() + span.length, out->end());
+	for (uint32_t i = 0; i < span.length; i++)
+	{
+		const StoredRewindableState<T>& stored = pool[span.offset + i];
+		if (i == out->size())
+			out->push_back(RewindableState<T>(stored.namespaceId));
+		RewindableState<T>& state = (*out)[i];
+		state.namespaceId = stored.namespaceId;
+		state.bindingIndex = stored.bindingIndex;
+		state.value = stored.value;
+	}
+}
+
+void FrameBlock::loadRewindableStrings(Span span, std::vector<RewindableState<std::string>>* out) const
+{
+	if (out->size() > span.length)
+		out->erase(out->begin() + span.length, out->end());
+	for (uint32_t i = 0; i < span.length; i++)
+	{
+		const StoredRewindableState<Span>& stored = rewindableStringPool[span.offset + i];
+		if (i == out->size())
+			out->push_back(RewindableState<std::string>(stored.namespaceId));
+		RewindableState<std::string>& state = (*out)[i];
+		state.namespaceId = stored.namespaceId;
+		state.bindingIndex = stored.bindingIndex;
+		loadString(stored.value, &state.value);
+	}
+}
+
+void FrameBlock::push(const Frame& frame)
+{
+	PoolMarks mark;
+	mark.ints = intPool.size();
+	mark.floats = floatPool.size();
+	mark.mpstates = mpstatePool.size();
+	mark.chars = charPool.size();
+	mark.rewindableInts = rewindableIntPool.size();
+	mark.rewindableFloats = rewindableFloatPool.size();
+	mark.rewindableBools = rewindableBoolPool.size();
+	mark.rewindableStrings = rewindableStringPool.size();
+
+	// The spans get computed before anything is pushed so they compare against the previous frame
+	Span ints[IntListCount];
+	ints[GemStates] = storeInts(frame.gemstates, intLists[GemStates]);
+	ints[TTStates] = storeInts(frame.ttstates, intLists[TTStates]);
+	ints[PowerupStates] = storeInts(frame.powerupstates, intLists[PowerupStates]);
+	ints[LMStates] = storeInts(frame.lmstates, intLists[LMStates]);
+	ints[ActivePowStates] = storeInts(frame.activepowstates, intLists[ActivePowStates]);
+	ints[TrapdoorDirs] = storeInts(frame.trapdoordirs, intLists[TrapdoorDirs]);
+	ints[TrapdoorOpen] = storeInts(frame.trapdooropen, intLists[TrapdoorOpen]);
+	ints[TrapdoorClose] = storeInts(frame.trapdoorclose, intLists[TrapdoorClose]);
+	Span trapdoorposSpan = storeFloats(frame.trapdoorpos, trapdoorpos);
+	Span mpstatesSpan = storeMPStates(frame.mpstates, mpstates);
+	Span gamestateSpan = storeString(frame.gamestate, gamestate);
+	Span gravityDirSpan = storeString(frame.gravityDir, gravityDir);
+
+	Span rewindables[RewindableListCount];
+	rewindables[RewindableInt] = storeRewindableStates(frame.rewindableIntStates, rewindableIntPool, rewindableLists[RewindableInt]);
+	rewindables[RewindableFloat] = storeRewindableStates(frame.rewindableFloatStates, rewindableFloatPool, rewindableLists[RewindableFloat]);
+	rewindables[RewindableBool] = storeRewindableStates(frame.rewindableBoolStates, rewindableBoolPool, rewindableLists[RewindableBool]);
+	rewindables[RewindableString] = storeRewindableStrings(frame.rewindableStringStates, rewindableLists[RewindableString]);
+	rewindables[RewindableSOInt] = storeRewindableStates(frame.rewindableSOIntStates, rewindableIntPool, rewindableLists[RewindableSOInt]);
+	rewindables[RewindableSOFloat] = storeRewindableStates(frame.rewindableSOFloatStates, rewindableFloatPool, rewindableLists[RewindableSOFloat]);
+	rewindables[RewindableSOBool] = storeRewindableStates(frame.rewindableSOBoolStates, rewindableBoolPool, rewindableLists[RewindableSOBool]);
+	rewindables[RewindableSOString] = storeRewindableStrings(frame.rewindableSOStringStates, rewindableLists[RewindableSOString]);
+
+#ifdef MBP
+	teleportDestination.push_back(storeString(frame.teleportState.destination, teleportDestination));
+	checkpointObj.push_back(storeString(frame.checkpointState.Obj, checkpointObj));
+	checkpointGemStates.push_back(storeString(frame.checkpointState.gemStates, checkpointGemStates));
+	checkpointGravity.push_back(storeString(frame.checkpointState.gravity, checkpointGravity));
+	checkpointRespawnOffset.push_back(storeString(frame.checkpointState.respawnOffset, checkpointRespawnOffset));
+	teleportDelay.push_back(frame.teleportState.teleportDelay);
+	teleportCounter.push_back(frame.teleportState.teleportCounter);
+	checkpointGemCount.push_back(frame.checkpointState.gemCount);
+	checkpointPowerup.push_back(frame.checkpointState.powerup);
+	checkpointRespawnCounter.push_back(frame.checkpointState.respawnCounter);
+	eggstate.push_back(frame.eggstate);
+#endif
+
+	for (int i = 0; i < IntListCount; i++)
+		intLists[i].push_back(ints[i]);
+	for (int i = 0; i < RewindableListCount; i++)
+		rewindableLists[i].push_back(rewindables[i]);
+	trapdoorpos.push_back(trapdoorposSpan);
+	mpstates.push_back(mpstatesSpan);
+	gamestate.push_back(gamestateSpan);
+	gravityDir.push_back(gravityDirSpan);
+
+	elapsedTime.push_back(frame.elapsedTime);
+	ms.push_back(frame.ms);
+	deltaMs.push_back(frame.deltaMs);
+	position.push_back(frame.position);
+	velocity.push_back(frame.velocity);
+	spin.push_back(frame.spin);
+	powerup.push_back(frame.powerup);
+	timebonus.push_back(frame.timebonus);
+	gemcount.push_back(frame.gemcount);
+	nextstatetime.push_back(frame.nextstatetime);
+	marks.push_back(mark);
+	duration += frame.deltaMs;
+}
+
+void FrameBlock::resizeColumns(int count)
+{
+	elapsedTime.resize(count);
+	ms.resize(count);
+	deltaMs.resize(count);
+	position.resize(count);
+	velocity.resize(count);
+	spin.resize(count);
+	powerup.resize(count);
+	timebonus.resize(count);
+	gemcount.resize(count);
+	nextstatetime.resize(count);
+	for (int i = 0; i < IntListCount; i++)
+		intLists[i].resize(count);
+	for (int i = 0; i < RewindableListCount; i++)
+		rewindableLists[i].resize(count);
+	trapdoorpos.resize(count);
+	mpstates.resize(count);
+	gamestate.resize(count);
+	gravityDir.resize(count);
+#ifdef MBP
+	teleportDelay.resize(count);
+	teleportDestination.resize(count);
+	teleportCounter.resize(count);
+	checkpointObj.resize(count);
+	checkpointGemCount.resize(count);
+	checkpointGemStates.resize(count);
+	checkpointPowerup.resize(count);
+	checkpointGravity.resize(count);
+	checkpointRespawnCounter.resize(count);
+	checkpointRespawnOffset.resize(count);
+	eggstate.resize(count);
+#endif
+	marks.resize(count);
+}
+
+void FrameBlock::truncate(int count)
+{
+	if (count >= size())
+		return;
+	if (count <= 0)
+	{
+		clear();
+		return;
+	}
+
+	// Everything the dropped frames appended sits after the marks of the first one
+	const PoolMarks& mark = marks[count];
+	intPool.resize(mark.ints);
+	floatPool.resize(mark.floats);
+	mpstatePool.resize(mark.mpstates);
+	charPool.resize(mark.chars);
+	rewindableIntPool.resize(mark.rewindableInts);
+	rewindableFloatPool.resize(mark.rewindableFloats);
+	rewindableBoolPool.resize(mark.rewindableBools);
+	rewindableStringPool.resize(mark.rewindableStrings);
+	for (int i = count; i < size(); i++)
+		duration -= deltaMs[i];
+	resizeColumns(count);
+}
+
+void FrameBlock::popBack()
+{
+	truncate(size() - 1);
+}
+
+void FrameBlock::clear()
+{
+	resizeColumns(0);
+	intPool.clear();
+	floatPool.clear();
+	mpstatePool.clear();
+	charPool.clear();
+	rewindableIntPool.clear();
+	rewindableFloatPool.clear();
+	rewindableBoolPool.clear();
+	rewindableStringPool.clear();
+	duration = 0;
+	thinned = false;
+}
+
+void FrameBlock::reserve(int count)
+{
+	elapsedTime.reserve(count);
+	ms.reserve(count);
+	deltaMs.reserve(count);
+	position.reserve(count);
+	velocity.reserve(count);
+	spin.reserve(count);
+	powerup.reserve(count);
+	timebonus.reserve(count);
+	gemcount.reserve(count);
+	nextstatetime.reserve(count);
+	marks.reserve(count);
+}
+
+void FrameBlock::get(int index, Frame* out) const
+{
+	out->elapsedTime = elapsedTime[index];
+	out->ms = ms[index];
+	out->deltaMs = deltaMs[index];
+	out->position = position[index];
+	out->velocity = velocity[index];
+	out->spin = spin[index];
+	out->powerup = powerup[index];
+	out->timebonus = timebonus[index];
+	out->gemcount = gemcount[index];
+	out->nextstatetime = nextstatetime[index];
+
+#define LOAD_INTS(list, field) { Span span = intLists[list][index]; out->field.assign(intPool.begin() + span.offset, intPool.begin() + span.offset + span.length); }
+	LOAD_INTS(GemStates, gemstates);
+	LOAD_INTS(TTStates, ttstates);
+	LOAD_INTS(PowerupStates, powerupstates);
+	LOAD_INTS(LMStates, lmstates);
+	LOAD_INTS(ActivePowStates, activepowstates);
+	LOAD_INTS(TrapdoorDirs, trapdoordirs);
+	LOAD_INTS(TrapdoorOpen, trapdooropen);
+	LOAD_INTS(TrapdoorClose, trapdoorclose);
+#undef LOAD_INTS
+
+	Span span = trapdoorpos[index];
+	out->trapdoorpos.assign(floatPool.begin() + span.offset, floatPool.begin() + span.offset + span.length);
+	span = mpstates[index];
+	out->mpstates.assign(mpstatePool.begin() + span.offset, mpstatePool.begin() + span.offset + span.length);
+	out->gamestate = loadString(gamestate[index]);
+	out->gravityDir = loadString(gravityDir[index]);
+
+	loadRewindableStates(rewindableLists[RewindableInt][index], rewindableIntPool, &out->rewindableIntStates);
+	loadRewindableStates(rewindableLists[RewindableFloat][index], rewindableFloatPool, &out->rewindableFloatStates);
+	loadRewindableStates(rewindableLists[RewindableBool][index], rewindableBoolPool, &out->rewindableBoolStates);
+	loadRewindableStrings(rewindableLists[RewindableString][index], &out->rewindableStringStates);
+	loadRewindableStates(rewindableLists[RewindableSOInt][index], rewindableIntPool, &out->rewindableSOIntStates);
+	loadRewindableStates(rewindableLists[RewindableSOFloat][index], rewindableFloatPool, &out->rewindableSOFloatStates);
+	loadRewindableStates(rewindableLists[RewindableSOBool][index], rewindableBoolPool, &out->rewindableSOBoolStates);
+	loadRewindableStrings(rewindableLists[RewindableSOString][index], &out->rewindableSOStringStates);
+
+#ifdef MBP
+	out->teleportState.teleportDelay = teleportDelay[index];
+	out->teleportState.destination = loadString(teleportDestination[index]);
+	out->teleportState.teleportCounter = teleportCounter[index];
+	out->checkpointState.Obj = loadString(checkpointObj[index]);
+	out->checkpointState.gemCount = checkpointGemCount[index];
+	out->checkpointState.gemStates = loadString(checkpointGemStates[index]);
+	out->checkpointState.powerup = checkpointPowerup[index];
+	out->checkpointState.gravity = loadString(checkpointGravity[index]);
+	out->checkpointState.respawnCounter = checkpointRespawnCounter[index];
+	out->checkpointState.respawnOffset = loadString(checkpointRespawnOffset[index]);
+	out->eggstate = eggstate[index] != 0;
+#endif
+}
+
+Frame FrameBlock::get(int index) const
+{
+	Frame frame;
+	get(index, &frame);
+	return frame;
+}
+
+static bool sameSpan(FrameBlock::Span one, FrameBlock::Span two)
+{
+	return one.offset == two.offset && one.length == two.length;
+}
+
+bool FrameBlock::sameStateAsPrevious(int index) const
+{
+	if (index <= 0)
+		return false;
+
+	int prev = index - 1;
+	if (powerup[index] != powerup[prev] || gemcount[index] != gemcount[prev])
+		return false;
+
+	// Unchanged lists reuse the span of the previous frame, so comparing spans is enough
+	for (int i = 0; i < IntListCount; i++)
+	{
+		if (!sameSpan(intLists[i][index], intLists[i][prev]))
+			return false;
+	}
+	for (int i = 0; i < RewindableListCount; i++)
+	{
+		if (!sameSpan(rewindableLists[i][index], rewindableLists[i][prev]))
+			return false;
+	}
+	if (!sameSpan(trapdoorpos[index], trapdoorpos[prev]) || !sameSpan(gamestate[index], gamestate[prev]) || !sameSpan(gravityDir[index], gravityDir[prev]))
+		return false;
+
+	// Moving platforms move every frame, only their targets are discrete
+	if (mpstates[index].length != mpstates[prev].length)
+		return false;
+	for (uint32_t i = 0; i < mpstates[index].length; i++)
+	{
+		if (getMPState(index, i).targetPosition != getMPState(prev, i).targetPosition)
+			return false;
+	}
+
+#ifdef MBP
+	if (teleportDelay[index] != teleportDelay[prev] || teleportCounter[index] != teleportCounter[prev] || !sameSpan(teleportDestination[index], teleportDestination[prev]))
+		return false;
+	if (checkpointGemCount[index] != checkpointGemCount[prev] || checkpointPowerup[index] != checkpointPowerup[prev] || checkpointRespawnCounter[index] != checkpointRespawnCounter[prev])
+		return false;
+	if (!sameSpan(checkpointObj[index], checkpointObj[prev]) || !sameSpan(checkpointGemStates[index], checkpointGemStates[prev])
+		|| !sameSpan(checkpointGravity[index], checkpointGravity[prev]) || !sameSpan(checkpointRespawnOffset[index], checkpointRespawnOffset[prev]))
+		return false;
+	if (eggstate[index] != eggstate[prev])
+		return false;
+#endif
+	return true;
+}
+
+template<typename T>
+static void eraseSecondToLast(std::vector<T>& column)
+{
+	column.erase(column.end() - 2);
+}
+
+void FrameBlock::dropSecondToLast()
+{
+	int last = size() - 1;
+	int drop = last - 1;
+
+	// The last frame shares every span with the dropped one, only its moving platforms may live past the dropped frame's marks.
+	// Both sets of moving platforms are in the pool back to back, move the last frame's down over the dropped one's
+	Span lastMP = mpstates[last];
+	Span dropMP = mpstates[drop];
+	if (lastMP.offset != dropMP.offset && dropMP.offset >= marks[drop].mpstates)
+	{
+		std::copy(mpstatePool.begin() + lastMP.offset, mpstatePool.begin() + lastMP.offset + lastMP.length, mpstatePool.begin() + dropMP.offset);
+		mpstatePool.resize(dropMP.offset + lastMP.length);
+		mpstates[last].offset = dropMP.offset;
+	}
+	marks[last] = marks[drop];
+
+	// The dropped frame's time now belongs to the last one, the block duration stays the same
+	deltaMs[last] += deltaMs[drop];
+
+	eraseSecondToLast(elapsedTime);
+	eraseSecondToLast(ms);
+	eraseSecondToLast(deltaMs);
+	eraseSecondToLast(position);
+	eraseSecondToLast(velocity);
+	eraseSecondToLast(spin);
+	eraseSecondToLast(powerup);
+	eraseSecondToLast(timebonus);
+	eraseSecondToLast(gemcount);
+	eraseSecondToLast(nextstatetime);
+	for (int i = 0; i < IntListCount; i++)
+		eraseSecondToLast(intLists[i]);
+	for (int i = 0; i < RewindableListCount; i++)
+		eraseSecondToLast(rewindableLists[i]);
+	eraseSecondToLast(trapdoorpos);
+	eraseSecondToLast(mpstates);
+	eraseSecondToLast(gamestate);
+	eraseSecondToLast(gravityDir);
+#ifdef MBP
+	eraseSecondToLast(teleportDelay);
+	eraseSecondToLast(teleportDestination);
+	eraseSecondToLast(teleportCounter);
+	eraseSecondToLast(checkpointObj);
+	eraseSecondToLast(checkpointGemCount);
+	eraseSecondToLast(checkpointGemStates);
+	eraseSecondToLast(checkpointPowerup);
+	eraseSecondToLast(checkpointGravity);
+	eraseSecondToLast(checkpointRespawnCounter);
+	eraseSecondToLast(checkpointRespawnOffset);
+	eraseSecondToLast(eggstate);
+#endif
+	eraseSecondToLast(marks);
+}
+
+template<typename T>
+static size_t vectorMemory(const std::vector<T>& vec)
+{
+	return vec.capacity() * sizeof(T);
+}
+
+size_t FrameBlock::getMemoryUsage() const
+{
+	size_t total = sizeof(FrameBlock);
+	total += vectorMemory(elapsedTime) + vectorMemory(ms) + vectorMemory(deltaMs);
+	total += vectorMemory(position) + vectorMemory(velocity) + vectorMemory(spin);
+	total += vectorMemory(powerup) + vectorMemory(timebonus) + vectorMemory(gemcount) + vectorMemory(nextstatetime);
+	for (int i = 0; i < IntListCount; i++)
+		total += vectorMemory(intLists[i]);
+	for (int i = 0; i < RewindableListCount; i++)
+		total += vectorMemory(rewindableLists[i]);
+	total += vectorMemory(trapdoorpos) + vectorMemory(mpstates) + vectorMemory(gamestate) + vectorMemory(gravityDir);
+#ifdef MBP
+	total += vectorMemory(teleportDelay) + vectorMemory(teleportDestination) + vectorMemory(teleportCounter);
+	total += vectorMemory(checkpointObj) + vectorMemory(checkpointGemCount) + vectorMemory(checkpointGemStates) + vectorMemory(checkpointPowerup);
+	total += vectorMemory(checkpointGravity) + vectorMemory(checkpointRespawnCounter) + vectorMemory(checkpointRespawnOffset) + vectorMemory(eggstate);
+#endif
+	total += vectorMemory(marks);
+	total += vectorMemory(intPool) + vectorMemory(floatPool) + vectorMemory(mpstatePool) + vectorMemory(charPool);
+	total += vectorMemory(rewindableIntPool) + vectorMemory(rewindableFloatPool) + vectorMemory(rewindableBoolPool) + vectorMemory(rewindableStringPool);
+	return total;
+}
+
+void FrameBlock::thin(int keepEvery)
+{
+	FrameBlock thinnedBlock;
+	Frame frame;
+	int droppedDelta = 0;
+	for (int i = 0; i < size(); i++)
+	{
+		if ((i + 1) % keepEvery != 0 && i != size() - 1)
+		{
+			droppedDelta += deltaMs[i];
+			continue;
+		}
+		get(i, &frame);
+		frame.deltaMs += droppedDelta;
+		droppedDelta = 0;
+		thinnedBlock.push(frame);
+	}
+	thinnedBlock.thinned = true;
+	// Swapping with a fresh block also gives back the capacity the dropped frames used
+	std::swap(*this, thinnedBlock);
+}
+
+template<typename T>
+void FrameBlock::resolveRewindableBindings(std::vector<StoredRewindableState<T>>& pool, const std::function<int(int)>& resolve)
+{
+	for (auto& stored : pool)
+		stored.bindingIndex = resolve(stored.namespaceId);
+}
+
+void FrameBlock::resolveRewindableBindings(const std::function<int(int)>& resolve)
+{
+	resolveRewindableBindings(rewindableIntPool, resolve);
+	resolveRewindableBindings(rewindableFloatPool, resolve);
+	resolveRewindableBindings(rewindableBoolPool, resolve);
+	resolveRewindableBindings(rewindableStringPool, resolve);
+}
+
+template<typename T>
+void FrameBlock::markRewindableNamespaces(const std::vector<StoredRewindableState<T>>& pool, std::vector<bool>* used) const
+{
+	for (auto& stored : pool)
+	{
+		if (stored.namespaceId < 0)
+			continue;
+		if ((size_t)stored.namespaceId >= used->size())
+			used->resize(stored.namespaceId + 1, false);
+		(*used)[stored.namespaceId] = true;
+	}
+}
+
+void FrameBlock::markRewindableNamespaces(std::vector<bool>* used) const
+{
+	markRewindableNamespaces(rewindableIntPool, used);
+	markRewindableNamespaces(rewindableFloatPool, used);
+	markRewindableNamespaces(rewindableBoolPool, used);
+	markRewindableNamespaces(rewindableStringPool, used);
+}
+
+FrameStore::FrameStore()
+{
+	this->count = 0;
+}
+
+void FrameStore::updateBlockStarts()
+{
+	blockStart.resize(blocks.size());
+	int start = 0;
+	for (size_t i = 0; i < blocks.size(); i++)
+	{
+		blockStart[i] = start;
+		start += blocks[i].size();
+	}
+	count = start;
+}
+
+int FrameStore::findBlock(int index) const
+{
+	// Most lookups are near the end of the history
+	int last = blocks.size() - 1;
+	if (index >= blockStart[last])
+		return last;
+
+	int lo = 0, hi = last;
+	while (lo < hi)
+	{
+		int m = (lo + hi + 1) / 2;
+		if (blockStart[m] <= index)
+			lo = m;
+		else
+			hi = m - 1;
+	}
+	return lo;
+}
+
+void FrameStore::push(const Frame& frame)
+{
+	if (blocks.size() == 0 || blocks.back().size() >= FRAME_BLOCK_FRAMES)
+	{
+		blocks.push_back(FrameBlock());
+		blocks.back().reserve(FRAME_BLOCK_FRAMES);
+		blockStart.push_back(count);
+	}
+	blocks.back().push(frame);
+	count++;
+}
+
+void FrameStore::popBack()
+{
+	truncate(count - 1);
+}
+
+void FrameStore::truncate(int newCount)
+{
+	if (newCount >= count)
+		return;
+	if (newCount <= 0)
+	{
+		clear();
+		return;
+	}
+
+	int block = findBlock(newCount);
+	int inBlock = newCount - blockStart[block];
+	blocks.erase(blocks.begin() + block + (inBlock == 0 ? 0 : 1), blocks.end());
+	if (inBlock != 0)
+		blocks.back().truncate(inBlock);
+	blockStart.resize(blocks.size());
+	count = newCount;
+}
+
+void FrameStore::clear()
+{
+	blocks.clear();
+	blockStart.clear();
+	count = 0;
+}
+
+void FrameStore::get(int index, Frame* out) const
+{
+	int block = findBlock(index);
+	blocks[block].get(index - blockStart[block], out);
+}
+
+Frame FrameStore::get(int index) const
+{
+	Frame frame;
+	get(index, &frame);
+	return frame;
+}
+
+int FrameStore::getMs(int index) const
+{
+	int block = findBlock(index);
+	return blocks[block].getMs(index - blockStart[block]);
+}
+
+int FrameStore::getDeltaMs(int index) const
+{
+	int block = findBlock(index);
+	return blocks[block].getDeltaMs(index - blockStart[block]);
+}
+
+int FrameStore::getElapsedTime(int index) const
+{
+	int block = findBlock(index);
+	return blocks[block].getElapsedTime(index - blockStart[block]);
+}
+
+void FrameStore::setElapsedTime(int index, int time)
+{
+	int block = findBlock(index);
+	blocks[block].setElapsedTime(index - blockStart[block], time);
+}
+
+int FrameStore::getTimebonus(int index) const
+{
+	int block = findBlock(index);
+	return blocks[block].getTimebonus(index - blockStart[block]);
+}
+
+int FrameStore::getNextStateTime(int index) const
+{
+	int block = findBlock(index);
+	return blocks[block].getNextStateTime(index - blockStart[block]);
+}
+
+const Point3D& FrameStore::getPosition(int index) const
+{
+	int block = findBlock(index);
+	return blocks[block].getPosition(index - blockStart[block]);
+}
+
+const Point3D& FrameStore::getVelocity(int index) const
+{
+	int block = findBlock(index);
+	return blocks[block].getVelocity(index - blockStart[block]);
+}
+
+const Point3D& FrameStore::getSpin(int index) const
+{
+	int block = findBlock(index);
+	return blocks[block].getSpin(index - blockStart[block]);
+}
+
+int FrameStore::getMPStateCount(int index) const
+{
+	int block = findBlock(index);
+	return blocks[block].getMPStateCount(index - blockStart[block]);
+}
+
+const MPState& FrameStore::getMPState(int index, int mp) const
+{
+	int block = findBlock(index);
+	return blocks[block].getMPState(index - blockStart[block], mp);
+}
+
+bool FrameStore::sameStateAsPrevious(int index) const
+{
+	int block = findBlock(index);
+	return blocks[block].sameStateAsPrevious(index - blockStart[block]);
+}
+
+void FrameStore::dropSecondToLast()
+{
+	blocks.back().dropSecondToLast();
+	count--;
+}
+
+int FrameStore::getDuration() const
+{
+	int total = 0;
+	for (auto& block : blocks)
+		total += block.getDuration();
+	return total;
+}
+
+size_t FrameStore::getMemoryUsage() const
+{
+	size_t total = 0;
+	for (auto& block : blocks)
+		total += block.getMemoryUsage();
+	return total;
+}
+
+void FrameStore::dropOldestBlock()
+{
+	if (blocks.size() == 0)
+		return;
+	blocks.pop_front();
+	updateBlockStarts();
+}
+
+void FrameStore::thinBlock(int index, int keepEvery)
+{
+	blocks[index].thin(keepEvery);
+	updateBlockStarts();
+}
+
+void FrameStore::resolveRewindableBindings(const std::function<int(int)>& resolve)
+{
+	for (auto& block : blocks)
+		block.resolveRewindableBindings(resolve);
+}
+
+void FrameStore::markRewindableNamespaces(std::vector<bool>* used) const
+{
+	for (auto& block : blocks)
+		block.markRewindableNamespaces(used);
+}
@@ -0,0 +1,245 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+#include "frame.h"
+
+// Frames per FrameBlock, history is dropped or thinned a block at a time
+#define FRAME_BLOCK_FRAMES 512
+
+/*
+*	Columnar storage for recorded frames.
+*
+*	Every scalar field of Frame gets its own contiguous array, so binary searches over ms/elapsedTime only touch the memory they compare.
+*	The variable length lists (gem states, moving platforms, rewindable states...) are appended to a handful of shared pools and each frame
+*	keeps an offset/length span into them. Most of the mission state doesn't change between two frames, so a list identical to the one
+*	of the previous frame just reuses its span instead of being stored again.
+*
+*	Frame stays around as the materialized view of a single frame, get() fills one in from the columns.
+*
+*	FrameStore strings FRAME_BLOCK_FRAMES sized FrameBlocks together. Spans are never shared across blocks, so the oldest block can be
+*	dropped or rebuilt on its own, which is what keeps the rewind history inside its memory budget.
+*/
+class FrameBlock
+{
+public:
+	struct Span
+	{
+		uint32_t offset;
+		uint32_t length;
+	};
+
+	template<typename T>
+	struct StoredRewindableState
+	{
+		int namespaceId;
+		int bindingIndex;
+		T value;
+	};
+
+private:
+	enum IntList
+	{
+		GemStates,
+		TTStates,
+		PowerupStates,
+		LMStates,
+		ActivePowStates,
+		TrapdoorDirs,
+		TrapdoorOpen,
+		TrapdoorClose,
+		IntListCount
+	};
+
+	enum RewindableList
+	{
+		RewindableInt,
+		RewindableFloat,
+		RewindableBool,
+		RewindableString,
+		RewindableSOInt,
+		RewindableSOFloat,
+		RewindableSOBool,
+		RewindableSOString,
+		RewindableListCount
+	};
+
+	// Size of every pool before a frame was pushed, lets us drop frames off the back without scanning the spans
+	struct PoolMarks
+	{
+		uint32_t ints;
+		uint32_t floats;
+		uint32_t mpstates;
+		uint32_t chars;
+		uint32_t rewindableInts;
+		uint32_t rewindableFloats;
+		uint32_t rewindableBools;
+		uint32_t rewindableStrings;
+	};
+
+	// Scalar columns
+	std::vector<int> elapsedTime;
+	std::vector<int> ms;
+	std::vector<int> deltaMs;
+	std::vector<Point3D> position;
+	std::vector<Point3D> velocity;
+	std::vector<Point3D> spin;
+	std::vector<int> powerup;
+	std::vector<int> timebonus;
+	std::vector<int> gemcount;
+	std::vector<int> nextstatetime;
+
+	// Span columns
+	std::vector<Span> intLists[IntListCount];
+	std::vector<Span> trapdoorpos;
+	std::vector<Span> mpstates;
+	std::vector<Span> gamestate;
+	std::vector<Span> gravityDir;
+	std::vector<Span> rewindableLists[RewindableListCount];
+#ifdef MBP
+	std::vector<int> teleportDelay;
+	std::vector<Span> teleportDestination;
+	std::vector<int> teleportCounter;
+	std::vector<Span> checkpointObj;
+	std::vector<int> checkpointGemCount;
+	std::vector<Span> checkpointGemStates;
+	std::vector<int> checkpointPowerup;
+	std::vector<Span> checkpointGravity;
+	std::vector<int> checkpointRespawnCounter;
+	std::vector<Span> checkpointRespawnOffset;
+	std::vector<uint8_t> eggstate;
+#endif
+	std::vector<PoolMarks> marks;
+
+	// Pools
+	std::vector<int> intPool;
+	std::vector<float> floatPool;
+	std::vector<MPState> mpstatePool;
+	std::vector<char> charPool;
+	std::vector<StoredRewindableState<int>> rewindableIntPool;
+	std::vector<StoredRewindableState<float>> rewindableFloatPool;
+	std::vector<StoredRewindableState<bool>> rewindableBoolPool;
+	std::vector<StoredRewindableState<Span>> rewindableStringPool;
+
+	bool stringEquals(Span span, const std::string& str) const;
+	Span storeString(const std::string& str, const std::vector<Span>& column);
+	Span storeString(const std::string& str);
+	std::string loadString(Span span) const;
+	void loadString(Span span, std::string* out) const;
+	Span storeInts(const std::vector<int>& list, const std::vector<Span>& column);
+	Span storeFloats(const std::vector<float>& list, const std::vector<Span>& column);
+	Span storeMPStates(const std::vector<MPState>& list, const std::vector<Span>& column);
+	template<typename T>
+	Span storeRewindableStates(const std::vector<RewindableState<T>>& list, std::vector<StoredRewindableState<T>>& pool, const std::vector<Span>& column);
+	Span storeRewindableStrings(const std::vector<RewindableState<std::string>>& list, const std::vector<Span>& column);
+	template<typename T>
+	void loadRewindableStates(Span span, const std::vector<StoredRewindableState<T>>& pool, std::vector<RewindableState<T>>* out) const;
+	void loadRewindableStrings(Span span, std::vector<RewindableState<std::string>>* out) const;
+	void resizeColumns(int count);
+	template<typename T>
+	void resolveRewindableBindings(std::vector<StoredRewindableState<T>>& pool, const std::function<int(int)>& resolve);
+	template<typename T>
+	void markRewindableNamespaces(const std::vector<StoredRewindableState<T>>& pool, std::vector<bool>* used) const;
+
+	int duration;
+	bool thinned;
+
+public:
+	FrameBlock();
+
+	int size() const { return ms.size(); }
+	bool empty() const { return ms.empty(); }
+
+	void push(const Frame& frame);
+	void popBack();
+	// Drops every frame from index count onwards
+	void truncate(int count);
+	void clear();
+	void reserve(int count);
+
+	void get(int index, Frame* out) const;
+	Frame get(int index) const;
+	Frame back() const { return get(size() - 1); }
+
+	int getMs(int index) const { return ms[index]; }
+	int getDeltaMs(int index) const { return deltaMs[index]; }
+	int getElapsedTime(int index) const { return elapsedTime[index]; }
+	void setElapsedTime(int index, int time) { elapsedTime[index] = time; }
+	int getTimebonus(int index) const { return timebonus[index]; }
+	int getNextStateTime(int index) const { return nextstatetime[index]; }
+	const Point3D& getPosition(int index) const { return position[index]; }
+	const Point3D& getVelocity(int index) const { return velocity[index]; }
+	const Point3D& getSpin(int index) const { return spin[index]; }
+	int getMPStateCount(int index) const { return mpstates[index].length; }
+	const MPState& getMPState(int index, int mp) const { return mpstatePool[mpstates[index].offset + mp]; }
+
+	// True if none of the discrete state (lists, strings, powerup, gems...) changed since the previous frame
+	bool sameStateAsPrevious(int index) const;
+	// Removes the frame before the last one, only valid if sameStateAsPrevious holds for the last frame
+	void dropSecondToLast();
+
+	// Sum of deltaMs over the block
+	int getDuration() const { return duration; }
+	size_t getMemoryUsage() const;
+	bool isThinned() const { return thinned; }
+	// Rebuilds the block keeping every keepEvery-th frame (and the last one), the deltaMs of dropped frames goes to the next kept frame
+	void thin(int keepEvery);
+	// Sets the binding index of every stored rewindable state to resolve(its namespace id)
+	void resolveRewindableBindings(const std::function<int(int)>& resolve);
+	// Sets used[id] for the namespace id of every stored rewindable state, used grows to fit
+	void markRewindableNamespaces(std::vector<bool>* used) const;
+};
+
+class FrameStore
+{
+	std::deque<FrameBlock> blocks;
+	std::vector<int> blockStart; // Index of the first frame of every block
+	int count;
+
+	int findBlock(int index) const;
+	void updateBlockStarts();
+
+public:
+	FrameStore();
+
+	int size() const { return count; }
+	bool empty() const { return count == 0; }
+
+	void push(const Frame& frame);
+	void popBack();
+	// Drops every frame from index count onwards
+	void truncate(int count);
+	void clear();
+
+	void get(int index, Frame* out) const;
+	Frame get(int index) const;
+	Frame back() const { return get(size() - 1); }
+
+	int getMs(int index) const;
+	int getDeltaMs(int index) const;
+	int getElapsedTime(int index) const;
+	void setElapsedTime(int index, int time);
+	int getTimebonus(int index) const;
+	int getNextStateTime(int index) const;
+	const Point3D& getPosition(int index) const;
+	const Point3D& getVelocity(int index) const;
+	const Point3D& getSpin(int index) const;
+	int getMPStateCount(int index) const;
+	const MPState& getMPState(int index, int mp) const;
+
+	// Always false for the first frame of a block, spans aren't shared across blocks
+	bool sameStateAsPrevious(int index) const;
+	// Only valid if sameStateAsPrevious(size() - 1) holds
+	void dropSecondToLast();
+
+	int getBlockCount() const { return blocks.size(); }
+	const FrameBlock& getBlock(int index) const { return blocks[index]; }
+	int getDuration() const;
+	size_t getMemoryUsage() const;
+	void dropOldestBlock();
+	void thinBlock(int index, int keepEvery);
+	void resolveRewindableBindings(const std::function<int(int)>& resolve);
+	void markRewindableNamespaces(std::vector<bool>* used) const;
+};
@@ -0,0 +1,238 @@
+#include "LerpSpan.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define LERP_SPAN_X86
+#include <immintrin.h>
+#ifdef HAVE_CPUID_H
+#include <cpuid.h>
+#endif
+#ifdef HAVE_INTRIN_H
+#include <intrin.h>
+#endif
+#endif
+
+// The plugin is built without -msse2/-mavx2, gcc and clang need the kernels marked so they can use the intrinsics. MSVC doesn't care
+#if defined(__GNUC__) || defined(__clang__)
+#define LERP_TARGET_SSE2 __attribute__((target("sse2")))
+#define LERP_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define LERP_TARGET_SSE2
+#define LERP_TARGET_AVX2
+#endif
+
+#define CPUID_FLAG_SSE2 (1 << 26)
+#define CPUID_FLAG_OSXSAVE (1 << 27)
+#define CPUID_FLAG_AVX (1 << 28)
+#define CPUID_FLAG_AVX2 (1 << 5)
+// XMM and YMM state, the OS has to save both across context switches for AVX to be usable
+#define XCR0_AVX_STATE 6
+
+struct AvailableExtensions
+{
+	bool supportsSSE2;
+	bool supportsAVX2;
+};
+
+#ifdef LERP_SPAN_X86
+static unsigned long long readXCR0()
+{
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	unsigned int lo, hi;
+	__asm__ __volatile__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+	return ((unsigned long long)hi << 32) | lo;
+#endif
+}
+#endif
+
+static AvailableExtensions detectExtensions()
+{
+	AvailableExtensions result;
+	result.supportsSSE2 = false;
+	result.supportsAVX2 = false;
+#ifdef LERP_SPAN_X86
+	unsigned int maxLeaf = 0;
+	unsigned int eax1 = 0, ebx1 = 0, ecx1 = 0, edx1 = 0;
+	unsigned int eax7 = 0, ebx7 = 0, ecx7 = 0, edx7 = 0;
+
+#ifdef HAVE_CPUID_H
+	maxLeaf = __get_cpuid_max(0, NULL);
+	__get_cpuid(1, &eax1, &ebx1, &ecx1, &edx1);
+	if (maxLeaf >= 7)
+		__cpuid_count(7, 0, eax7, ebx7, ecx7, edx7);
+#endif
+#ifdef HAVE_INTRIN_H
+	int cpuInfo[4];
+	__cpuid(cpuInfo, 0);
+	maxLeaf = cpuInfo[0];
+	__cpuid(cpuInfo, 1);
+	eax1 = cpuInfo[0]; ebx1 = cpuInfo[1]; ecx1 = cpuInfo[2]; edx1 = cpuInfo[3];
+	if (maxLeaf >= 7)
+	{
+		__cpuidex(cpuInfo, 7, 0);
+		eax7 = cpuInfo[0]; ebx7 = cpuInfo[1]; ecx7 = cpuInfo[2]; edx7 = cpuInfo[3];
+	}
+#endif
+
+	result.supportsSSE2 = ((edx1 & CPUID_FLAG_SSE2) != 0);
+
+	// AVX2 also needs the OS to have enabled the YMM registers
+	bool hasAVX = ((ecx1 & CPUID_FLAG_OSXSAVE) != 0) && ((ecx1 & CPUID_FLAG_AVX) != 0) && ((readXCR0() & XCR0_AVX_STATE) == XCR0_AVX_STATE);
+	result.supportsAVX2 = result.supportsSSE2 && hasAVX && ((ebx7 & CPUID_FLAG_AVX2) != 0);
+#endif
+	return result;
+}
+
+static void lerpFloatsScalar(const float* one, const float* two, float ratio, float* out, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		out[i] = one[i] + (two[i] - one[i]) * ratio;
+}
+
+static void lerpIntsScalar(const int* one, const int* two, float ratio, int* out, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		out[i] = one[i] + (two[i] - one[i]) * ratio;
+}
+
+#ifdef LERP_SPAN_X86
+LERP_TARGET_SSE2 static void lerpFloatsSSE2(const float* one, const float* two, float ratio, float* out, size_t count)
+{
+	__m128 r = _mm_set1_ps(ratio);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 a = _mm_loadu_ps(one + i);
+		__m128 b = _mm_loadu_ps(two + i);
+		_mm_storeu_ps(out + i, _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), r)));
+	}
+	// Not lerpFloatsScalar, that one may do the math on the x87 unit and round differently
+	for (; i < count; i++)
+	{
+		__m128 a = _mm_load_ss(one + i);
+		__m128 b = _mm_load_ss(two + i);
+		_mm_store_ss(out + i, _mm_add_ss(a, _mm_mul_ss(_mm_sub_ss(b, a), r)));
+	}
+}
+
+LERP_TARGET_SSE2 static void lerpIntsSSE2(const int* one, const int* two, float ratio, int* out, size_t count)
+{
+	__m128 r = _mm_set1_ps(ratio);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i*)(one + i));
+		__m128i b = _mm_loadu_si128((const __m128i*)(two + i));
+		__m128 delta = _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(b, a)), r);
+		_mm_storeu_si128((__m128i*)(out + i), _mm_cvttps_epi32(_mm_add_ps(_mm_cvtepi32_ps(a), delta)));
+	}
+	for (; i < count; i++)
+	{
+		__m128 a = _mm_cvtsi32_ss(_mm_setzero_ps(), one[i]);
+		__m128 delta = _mm_mul_ss(_mm_cvtsi32_ss(_mm_setzero_ps(), two[i] - one[i]), r);
+		out[i] = _mm_cvttss_si32(_mm_add_ss(a, delta));
+	}
+}
+
+LERP_TARGET_AVX2 static void lerpFloatsAVX2(const float* one, const float* two, float ratio, float* out, size_t count)
+{
+	__m256 r = _mm256_set1_ps(ratio);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 a = _mm256_loadu_ps(one + i);
+		__m256 b = _mm256_loadu_ps(two + i);
+		_mm256_storeu_ps(out + i, _mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(b, a), r)));
+	}
+	_mm256_zeroupper();
+	lerpFloatsSSE2(one + i, two + i, ratio, out + i, count - i);
+}
+
+LERP_TARGET_AVX2 static void lerpIntsAVX2(const int* one, const int* two, float ratio, int* out, size_t count)
+{
+	__m256 r = _mm256_set1_ps(ratio);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256i a = _mm256_loadu_si256((const __m256i*)(one + i));
+		__m256i b = _mm256_loadu_si256((const __m256i*)(two + i));
+		__m256 delta = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(b, a)), r);
+		_mm256_storeu_si256((__m256i*)(out + i), _mm256_cvttps_epi32(_mm256_add_ps(_mm256_cvtepi32_ps(a), delta)));
+	}
+	_mm256_zeroupper();
+	lerpIntsSSE2(one + i, two + i, ratio, out + i, count - i);
+}
+#else
+// Nothing to dispatch to, isLerpSpanKernelSupported keeps these from being picked
+#define lerpFloatsSSE2 lerpFloatsScalar
+#define lerpIntsSSE2 lerpIntsScalar
+#define lerpFloatsAVX2 lerpFloatsScalar
+#define lerpIntsAVX2 lerpIntsScalar
+#endif
+
+struct LerpSpanKernels
+{
+	const char* name;
+	void (*floats)(const float* one, const float* two, float ratio, float* out, size_t count);
+	void (*ints)(const int* one, const int* two, float ratio, int* out, size_t count);
+};
+
+static const LerpSpanKernels kernels[LerpSpanKernelCount] =
+{
+	{ "scalar", lerpFloatsScalar, lerpIntsScalar },
+	{ "sse2", lerpFloatsSSE2, lerpIntsSSE2 },
+	{ "avx2", lerpFloatsAVX2, lerpIntsAVX2 }
+};
+
+static const AvailableExtensions extensions = detectExtensions();
+static LerpSpanKernel currentKernel = extensions.supportsAVX2 ? LerpSpanAVX2 : (extensions.supportsSSE2 ? LerpSpanSSE2 : LerpSpanScalar);
+
+void lerpSpan(const float* one, const float* two, float ratio, float* out, size_t count)
+{
+	kernels[currentKernel].floats(one, two, ratio, out, count);
+}
+
+void lerpSpan(const int* one, const int* two, float ratio, int* out, size_t count)
+{
+	kernels[currentKernel].ints(one, two, ratio, out, count);
+}
+
+LerpSpanKernel getLerpSpanKernel()
+{
+	return currentKernel;
+}
+
+bool setLerpSpanKernel(LerpSpanKernel kernel)
+{
+	if (!isLerpSpanKernelSupported(kernel))
+		return false;
+	currentKernel = kernel;
+	return true;
+}
+
+bool isLerpSpanKernelSupported(LerpSpanKernel kernel)
+{
+	switch (kernel)
+	{
+	case LerpSpanScalar:
+		return true;
+	case LerpSpanSSE2:
+		return extensions.supportsSSE2;
+	case LerpSpanAVX2:
+		return extensions.supportsAVX2;
+	default:
+		return false;
+	}
+}
+
+const char* getLerpSpanKernelName(LerpSpanKernel kernel)
+{
+	if (kernel < 0 || kernel >= LerpSpanKernelCount)
+		return "unknown";
+	return kernels[kernel].name;
+}
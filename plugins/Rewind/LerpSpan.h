@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+
+/*
+*	Linear interpolation over contiguous arrays, used for the numeric lists of a frame (powerup and landmine timers, trapdoor positions...).
+*
+*	There's a scalar, an SSE2 and an AVX2 version of every kernel. The best one the CPU supports gets picked the first time a span is
+*	interpolated, with the same cpuid checks TorqueLib does for its math library. The SSE2 and AVX2 kernels give exactly the same results,
+*	leftover elements included: the same single precision operations in the same order, no FMA. The scalar one only matches them where
+*	the compiler does float math in SSE registers. The 32 bit gcc/clang build uses the x87 unit, which keeps the intermediate result in
+*	extended precision, so the scalar kernel can be off by the last bit there.
+*/
+enum LerpSpanKernel
+{
+	LerpSpanScalar = 0,
+	LerpSpanSSE2 = 1,
+	LerpSpanAVX2 = 2,
+	LerpSpanKernelCount
+};
+
+// out[i] = one[i] + (two[i] - one[i]) * ratio. out may be one or two
+void lerpSpan(const float* one, const float* two, float ratio, float* out, size_t count);
+// Same, with the difference taken as ints and the result truncated towards zero
+void lerpSpan(const int* one, const int* two, float ratio, int* out, size_t count);
+
+LerpSpanKernel getLerpSpanKernel();
+// False if the CPU doesn't support kernel, the current one stays then
+bool setLerpSpanKernel(LerpSpanKernel kernel);
+bool isLerpSpanKernelSupported(LerpSpanKernel kernel);
+const char* getLerpSpanKernelName(LerpSpanKernel kernel);
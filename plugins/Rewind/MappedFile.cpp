@@ -0,0 +1,92 @@
+#include "MappedFile.h"
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+	this->data = NULL;
+	this->size = 0;
+#ifdef WIN32
+	this->fileHandle = INVALID_HANDLE_VALUE;
+	this->mappingHandle = NULL;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open(std::string path)
+{
+	close();
+#ifdef WIN32
+	this->fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (this->fileHandle == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(this->fileHandle, &fileSize) || fileSize.QuadPart == 0)
+	{
+		close();
+		return false;
+	}
+	this->size = (size_t)fileSize.QuadPart;
+
+	this->mappingHandle = CreateFileMappingA(this->fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (this->mappingHandle == NULL)
+	{
+		close();
+		return false;
+	}
+	this->data = (const uint8_t*)MapViewOfFile(this->mappingHandle, FILE_MAP_READ, 0, 0, 0);
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd == -1)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		::close(fd);
+		return false;
+	}
+	this->size = st.st_size;
+
+	void* mapped = mmap(NULL, this->size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// The mapping stays valid after the descriptor is closed
+	::close(fd);
+	this->data = mapped == MAP_FAILED ? NULL : (const uint8_t*)mapped;
+#endif
+	if (this->data == NULL)
+	{
+		close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::close()
+{
+#ifdef WIN32
+	if (this->data != NULL)
+		UnmapViewOfFile(this->data);
+	if (this->mappingHandle != NULL)
+		CloseHandle(this->mappingHandle);
+	if (this->fileHandle != INVALID_HANDLE_VALUE)
+		CloseHandle(this->fileHandle);
+	this->mappingHandle = NULL;
+	this->fileHandle = INVALID_HANDLE_VALUE;
+#else
+	if (this->data != NULL)
+		munmap((void*)this->data, this->size);
+#endif
+	this->data = NULL;
+	this->size = 0;
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+/*
+*	Read only memory mapping of a whole file, so replays can be parsed straight out of the page cache instead of being fread into a buffer first.
+*/
+class MappedFile
+{
+	const uint8_t* data;
+	size_t size;
+#ifdef WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#endif
+
+public:
+	MappedFile();
+	~MappedFile();
+	bool open(std::string path);
+	void close();
+
+	const uint8_t* getData() { return data; }
+	size_t getSize() { return size; }
+};
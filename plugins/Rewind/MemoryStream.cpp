@@ -4,6 +4,7 @@
 #include <cstring>
 #include <exception>
 #include <stdexcept>
+#include <TorqueLib/math/mPoint3.h>
 
 MemoryStream::MemoryStream()
 {
@@ -11,16 +12,26 @@ MemoryStream::MemoryStream()
 	this->bufferSize = 256;
 	this->properSize = 0;
 	this->position = 0;
+	this->ownsBuffer = true;
 }
 
 MemoryStream::~MemoryStream()
 {
-	delete[] this->buffer;
+	releaseBuffer();
+}
+
+void MemoryStream::releaseBuffer()
+{
+	if (this->ownsBuffer)
+		delete[] this->buffer;
+	this->buffer = NULL;
+	this->bufferSize = 0;
+	this->ownsBuffer = true;
 }
 
 void MemoryStream::createFromBuffer(uint8_t* buffer, size_t count)
 {
-	delete[] this->buffer;
+	releaseBuffer();
 	this->buffer = new uint8_t[count];
 	this->bufferSize = count;
 	this->properSize = count;
@@ -28,6 +39,42 @@ void MemoryStream::createFromBuffer(uint8_t* buffer, size_t count)
 	memcpy(this->buffer, buffer, count);
 }
 
+void MemoryStream::borrowBuffer(const uint8_t* buffer, size_t count)
+{
+	releaseBuffer();
+	this->buffer = const_cast<uint8_t*>(buffer);
+	this->bufferSize = count;
+	this->properSize = count;
+	this->position = 0;
+	this->ownsBuffer = false;
+}
+
+uint8_t* MemoryStream::allocate(size_t count)
+{
+	if (!this->ownsBuffer || this->bufferSize < count)
+	{
+		releaseBuffer();
+		this->buffer = new uint8_t[count + 1];
+		this->bufferSize = count + 1;
+	}
+	this->properSize = count;
+	this->position = 0;
+	return this->buffer;
+}
+
+void MemoryStream::clear()
+{
+	this->properSize = 0;
+	this->position = 0;
+}
+
+void MemoryStream::truncate(size_t count)
+{
+	if (count < this->properSize)
+		this->properSize = count;
+	this->position = this->properSize;
+}
+
 char MemoryStream::readChar()
 {
 	unsigned char chr = readUChar();
@@ -114,33 +161,52 @@ uint64_t MemoryStream::readUInt64()
 
 float MemoryStream::readFloat()
 {
-	checkEos();
-	uint8_t bytes[] = { readUInt8(), readUInt8(), readUInt8(), readUInt8() };
 	float ret;
-	memcpy(&ret, bytes, 4);
+	readBytes(&ret, sizeof(float));
 	return ret;
 }
 
 double MemoryStream::readDouble()
 {
-	checkEos();
-	uint64_t bytes = readUInt64();
-	double ret = *reinterpret_cast<double*>(&bytes);
+	double ret;
+	readBytes(&ret, sizeof(double));
 	return ret;
 }
 
 std::string MemoryStream::readString()
 {
-	int len = readUInt32();
-	char* str = new char[len + 1];
-	for (int i = 0; i < len; i++)
-		str[i] = readChar();
-	str[len] = '\0';
-	return std::string(str);
+	uint32_t len = readUInt32();
+	checkRemaining(len);
+	std::string str(len, '\0');
+	readBytes(&str[0], len);
+	return str;
+}
+
+void MemoryStream::readPoint3D(Point3D* out)
+{
+	double xyz[3];
+	readArray(xyz, 3);
+	out->set(xyz[0], xyz[1], xyz[2]);
+}
+
+void MemoryStream::readBytes(void* out, size_t count)
+{
+	checkRemaining(count);
+	memcpy(out, &this->buffer[this->position], count);
+	this->position += count;
 }
 
 void MemoryStream::reallocate()
 {
+	if (!this->ownsBuffer)
+	{
+		// Never write into borrowed memory
+		uint8_t* newBuffer = new uint8_t[this->bufferSize + this->REALLOCATE_SIZE]();
+		memcpy(newBuffer, this->buffer, this->properSize);
+		this->buffer = newBuffer;
+		this->bufferSize += this->REALLOCATE_SIZE;
+		this->ownsBuffer = true;
+	}
 	if (this->position >= this->bufferSize)
 	{
 		this->bufferSize += this->REALLOCATE_SIZE;
@@ -151,6 +217,32 @@ void MemoryStream::reallocate()
 	}
 }
 
+void MemoryStream::reserveWrite(size_t count)
+{
+	if (this->ownsBuffer && this->position + count <= this->bufferSize)
+		return;
+
+	size_t newSize = this->bufferSize + this->REALLOCATE_SIZE;
+	if (newSize < this->position + count)
+		newSize = this->position + count + this->REALLOCATE_SIZE;
+	uint8_t* newBuffer = new uint8_t[newSize]();
+	memcpy(newBuffer, this->buffer, this->properSize);
+	if (this->ownsBuffer)
+		delete[] this->buffer;
+	this->buffer = newBuffer;
+	this->bufferSize = newSize;
+	this->ownsBuffer = true;
+}
+
+void MemoryStream::writeBytes(const void* data, size_t count)
+{
+	reserveWrite(count);
+	memcpy(&this->buffer[this->position], data, count);
+	this->position += count;
+	if (this->position > this->properSize)
+		this->properSize = this->position;
+}
+
 void MemoryStream::writeChar(char chr)
 {
 	reallocate();
@@ -245,34 +337,24 @@ void MemoryStream::writeUInt64(uint64_t i64)
 
 void MemoryStream::writeFloat(float f)
 {
-	reallocate();
-	union {
-		float a;
-		uint8_t bytes[4];
-	} floatbytes;
-	floatbytes.a = f;
-	writeUInt8(floatbytes.bytes[0]);
-	writeUInt8(floatbytes.bytes[1]);
-	writeUInt8(floatbytes.bytes[2]);
-	writeUInt8(floatbytes.bytes[3]);
+	writeBytes(&f, sizeof(float));
 }
 
 void MemoryStream::writeDouble(double d)
 {
-	reallocate();
-	uint64_t reinterpreted = *reinterpret_cast<uint64_t*>(&d);
-	writeUInt64(reinterpreted);
+	writeBytes(&d, sizeof(double));
 }
 
-void MemoryStream::writeString(std::string s)
+void MemoryStream::writeString(const std::string& s)
 {
-	reallocate();
-	int len = s.length();
-	writeUInt32(len);
-	for (int i = 0; i < s.length(); i++)
-	{
-		writeChar(s[i]);
-	}
+	writeUInt32(s.length());
+	writeBytes(s.data(), s.length());
+}
+
+void MemoryStream::writePoint3D(const Point3D& point)
+{
+	double xyz[3] = { point.x, point.y, point.z };
+	writeArray(xyz, 3);
 }
 
 void MemoryStream::seek(size_t position)
@@ -296,6 +378,12 @@ uint8_t* MemoryStream::getBuffer()
 	return this->buffer;
 }
 
+void MemoryStream::checkRemaining(size_t count, size_t elementSize)
+{
+	if (this->position > this->properSize || count > (this->properSize - this->position) / elementSize)
+		throw std::runtime_error("End of stream!");
+}
+
 bool MemoryStream::checkEos(bool error)
 {
 	if (this->position >= this->properSize || this->position < 0)
@@ -2,6 +2,10 @@
 #include <cstdint>
 #include <cstdbool>
 #include <string>
+#include <vector>
+
+class Point3D;
+
 /*
 *	Original implementation of MemoryStream in C++
 */
@@ -14,13 +18,25 @@ class MemoryStream
 	size_t bufferSize;
 	size_t properSize;
 	size_t position;
+	bool ownsBuffer; // False while wrapping borrowed memory, the first write copies it
 
 	bool checkEos(bool error = true);
 	void reallocate();
+	// Makes room to write count more bytes at the current position
+	void reserveWrite(size_t count);
+	void releaseBuffer();
 public:
 	MemoryStream();
 	~MemoryStream();
 	void createFromBuffer(uint8_t* buffer, size_t count);
+	// Reads straight out of buffer without copying it, buffer has to outlive the stream (or the next createFromBuffer/borrowBuffer/allocate)
+	void borrowBuffer(const uint8_t* buffer, size_t count);
+	// Makes the stream count bytes long and returns its storage so it can be filled in place, eg. by uncompress.
+	// Whatever is already in the storage is left alone if it's big enough
+	uint8_t* allocate(size_t count);
+	void clear();
+	// Drops everything from count onwards and moves to the new end
+	void truncate(size_t count);
 	bool readBool();
 	int64_t readInt64();
 	int32_t readInt32();
@@ -35,6 +51,42 @@ public:
 	char readChar();
 	unsigned char readUChar();
 	std::string readString();
+	void readPoint3D(Point3D* out);
+	// Throws unless count more elements of elementSize bytes can be read. Element counts read from the stream go through this before anything gets allocated for them
+	void checkRemaining(size_t count, size_t elementSize = 1);
+
+	// Bulk copies, one bounds check for the whole thing. Same layout as count separate read<T>/write<T> calls since we're little endian
+	void readBytes(void* out, size_t count);
+	void writeBytes(const void* data, size_t count);
+
+	template<typename T>
+	void readArray(T* out, size_t count)
+	{
+		readBytes(out, count * sizeof(T));
+	}
+
+	template<typename T>
+	void writeArray(const T* data, size_t count)
+	{
+		writeBytes(data, count * sizeof(T));
+	}
+
+	// int32 element count followed by the elements
+	template<typename T>
+	void readVector(std::vector<T>* out)
+	{
+		uint32_t count = readUInt32();
+		checkRemaining(count, sizeof(T));
+		out->resize(count);
+		readArray(out->data(), count);
+	}
+
+	template<typename T>
+	void writeVector(const std::vector<T>& list)
+	{
+		writeUInt32(list.size());
+		writeArray(list.data(), list.size());
+	}
 
 	template<typename T>
 	void write(T);
@@ -55,7 +107,8 @@ public:
 	void writeDouble(double);
 	void writeChar(char);
 	void writeUChar(unsigned char);
-	void writeString(std::string);
+	void writeString(const std::string&);
+	void writePoint3D(const Point3D& point);
 	void seek(size_t position);
 	size_t tell();
 	size_t length();
@@ -0,0 +1,73 @@
+#include "RecordCursor.h"
+#include <algorithm>
+
+RecordCursor::RecordCursor()
+{
+	reset();
+}
+
+void RecordCursor::reset()
+{
+	this->recorded = 0;
+	this->shift = 0;
+	this->frontier = 0;
+	this->minShift = 0;
+}
+
+bool RecordCursor::isEmpty() const
+{
+	return this->recorded == 0 && this->shift == 0;
+}
+
+RecordCursor::Unrecord RecordCursor::unrecordFrom(int index, int* truncateTo)
+{
+	if (index >= this->recorded)
+		return UnrecordNothing;
+
+	if (index >= this->frontier)
+	{
+		*truncateTo = index + this->shift;
+	}
+	else
+	{
+		// Rewound into thinned history, there's no telling which recorded frame that is anymore. Keep what's certainly older and
+		// carry on recording from there, the thinned frames in between are lost either way
+		*truncateTo = index + this->minShift;
+		this->shift = this->minShift;
+		this->frontier = index;
+	}
+
+	if (*truncateTo == 0)
+	{
+		// Nothing was dropped, so there's nothing to keep
+		reset();
+		return UnrecordClear;
+	}
+	this->recorded = index;
+	return UnrecordTruncate;
+}
+
+RecordCursor::Unrecord RecordCursor::unrecordAll()
+{
+	bool wasEmpty = isEmpty();
+	reset();
+	return wasEmpty ? UnrecordNothing : UnrecordClear;
+}
+
+void RecordCursor::dropped(int count)
+{
+	this->frontier = std::max(this->frontier - count, 0);
+	this->shift += count;
+	this->minShift += count;
+	this->recorded -= count;
+	// Nothing thinned is left, every index lines up again
+	if (this->frontier == 0)
+		this->minShift = this->shift;
+}
+
+void RecordCursor::thinned(int count, int blockEnd)
+{
+	this->frontier = std::max(this->frontier - count, blockEnd);
+	this->shift += count;
+	this->recorded -= count;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+/*
+*	Which frames of the run being played the recorder already has.
+*
+*	The recorder counts frames in the order they were appended, while indices into Frames move whenever the history budget drops
+*	or thins blocks at the front. shift is how many frames went missing off the front, frontier is where thinning left off: past it
+*	index + shift is the recorder's frame, before it there's no telling which recorded frame an index is anymore, only that it's
+*	at least index + minShift.
+*
+*	The recorder keeps the full run no matter what the budget does. Rewinding only ever truncates it, just loading a state or a
+*	replay clears it.
+*/
+class RecordCursor
+{
+public:
+	int recorded; // Frames before this index have been handed to the recorder
+	int shift; // Frames dropped or thinned off the front by the history budget, the recorder still has them
+	int frontier; // Frames before this index were thinned and don't line up with the recorder anymore
+	int minShift; // What only dropping whole blocks added to shift, every index is at least this far behind the recorder
+
+	enum Unrecord
+	{
+		UnrecordNothing,
+		UnrecordTruncate, // Truncate the recorder to the count unrecordFrom returned
+		UnrecordClear // Clear the recorder, recording starts over from the first frame
+	};
+
+	RecordCursor();
+	void reset();
+	// True until something gets recorded, or if the recorder still has frames the budget dropped
+	bool isEmpty() const;
+	// Takes back every frame from index onwards. Frames the budget dropped stay recorded, below the frontier it truncates to the last
+	// frame that's certainly older than index
+	Unrecord unrecordFrom(int index, int* truncateTo);
+	// Takes back everything, including what the budget dropped. For when Frames gets replaced by a saved state or a replay
+	Unrecord unrecordAll();
+	// The budget removed count frames at the front
+	void dropped(int count);
+	// The budget thinned count frames out of the blocks that end at blockEnd
+	void thinned(int count, int blockEnd);
+};
@@ -0,0 +1,231 @@
+#include "ReplayCodec.h"
+#include <zlib.h>
+#include <cstring>
+#include <vector>
+
+// LZ sequences are [token][literal length...][literals][uint16 offset][match length...], the token holding 4 bits of each length.
+// The last sequence is literals only
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 0xFFFF
+#define LZ_HASH_BITS 14
+
+static uint32_t read32(const uint8_t* p)
+{
+	uint32_t value;
+	memcpy(&value, p, sizeof(uint32_t));
+	return value;
+}
+
+static uint8_t* writeLength(uint8_t* op, size_t length)
+{
+	for (; length >= 255; length -= 255)
+		*op++ = 255;
+	*op++ = (uint8_t)length;
+	return op;
+}
+
+static bool readLength(const uint8_t** ip, const uint8_t* end, size_t* length)
+{
+	uint8_t byte;
+	do
+	{
+		if (*ip >= end)
+			return false;
+		byte = *(*ip)++;
+		*length += byte;
+	} while (byte == 255);
+	return true;
+}
+
+static uint8_t* writeSequence(uint8_t* op, const uint8_t* literals, size_t literalLength, size_t offset, size_t matchLength)
+{
+	size_t extraMatch = matchLength - LZ_MIN_MATCH;
+	uint8_t* token = op++;
+	*token = (uint8_t)((literalLength < 15 ? literalLength : 15) << 4);
+	if (literalLength >= 15)
+		op = writeLength(op, literalLength - 15);
+	if (literalLength != 0)
+		memcpy(op, literals, literalLength);
+	op += literalLength;
+	if (matchLength == 0)
+		return op;
+
+	*op++ = offset & 0xFF;
+	*op++ = (offset >> 8) & 0xFF;
+	*token |= extraMatch < 15 ? extraMatch : 15;
+	if (extraMatch >= 15)
+		op = writeLength(op, extraMatch - 15);
+	return op;
+}
+
+static size_t lzCompress(const uint8_t* in, size_t size, uint8_t* out)
+{
+	std::vector<uint32_t> table(1 << LZ_HASH_BITS, 0);
+	const uint8_t* ip = in;
+	const uint8_t* anchor = in;
+	const uint8_t* end = in + size;
+	uint8_t* op = out;
+
+	while (size >= LZ_MIN_MATCH && ip <= end - LZ_MIN_MATCH)
+	{
+		uint32_t sequence = read32(ip);
+		uint32_t hash = (sequence * 2654435761U) >> (32 - LZ_HASH_BITS);
+		const uint8_t* ref = in + table[hash];
+		table[hash] = ip - in;
+		if (ref >= ip || ip - ref > LZ_MAX_OFFSET || read32(ref) != sequence)
+		{
+			ip++;
+			continue;
+		}
+
+		size_t length = LZ_MIN_MATCH;
+		while (ip + length < end && ref[length] == ip[length])
+			length++;
+		op = writeSequence(op, anchor, ip - anchor, ip - ref, length);
+		ip += length;
+		anchor = ip;
+	}
+	return writeSequence(op, anchor, end - anchor, 0, 0) - out;
+}
+
+static bool lzUncompress(const uint8_t* in, size_t size, uint8_t* out, size_t outSize)
+{
+	const uint8_t* ip = in;
+	const uint8_t* end = in + size;
+	uint8_t* op = out;
+	uint8_t* outEnd = out + outSize;
+
+	while (ip < end)
+	{
+		uint8_t token = *ip++;
+		size_t literalLength = token >> 4;
+		if (literalLength == 15 && !readLength(&ip, end, &literalLength))
+			return false;
+		if (literalLength > (size_t)(end - ip) || literalLength > (size_t)(outEnd - op))
+			return false;
+		memcpy(op, ip, literalLength);
+		ip += literalLength;
+		op += literalLength;
+		if (ip == end)
+			break;
+
+		if (end - ip < 2)
+			return false;
+		size_t offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		size_t matchLength = token & 15;
+		if (matchLength == 15 && !readLength(&ip, end, &matchLength))
+			return false;
+		matchLength += LZ_MIN_MATCH;
+		if (offset == 0 || offset > (size_t)(op - out) || matchLength > (size_t)(outEnd - op))
+			return false;
+
+		const uint8_t* ref = op - offset;
+		if (offset >= matchLength)
+		{
+			memcpy(op, ref, matchLength);
+			op += matchLength;
+		}
+		else
+		{
+			// Overlapping match, repeats the last offset bytes
+			for (size_t i = 0; i < matchLength; i++)
+				*op++ = *ref++;
+		}
+	}
+	return op == outEnd;
+}
+
+ReplayCodec parseReplayCodec(std::string name)
+{
+	ReplayCodec codec;
+	codec.id = ReplayCodecZlib;
+	codec.level = Z_DEFAULT_COMPRESSION;
+	if (name == "raw")
+		codec.id = ReplayCodecRaw;
+	else if (name == "lz")
+		codec.id = ReplayCodecLZ;
+	else if (name.size() == 5 && name.compare(0, 4, "zlib") == 0 && name[4] >= '1' && name[4] <= '9')
+		codec.level = name[4] - '0';
+	return codec;
+}
+
+std::string getReplayCodecName(ReplayCodec codec)
+{
+	switch (codec.id)
+	{
+	case ReplayCodecRaw:
+		return "raw";
+	case ReplayCodecLZ:
+		return "lz";
+	default:
+		if (codec.level == Z_DEFAULT_COMPRESSION)
+			return "zlib";
+		return "zlib" + std::to_string(codec.level);
+	}
+}
+
+size_t replayCompressBound(ReplayCodec codec, size_t size)
+{
+	switch (codec.id)
+	{
+	case ReplayCodecRaw:
+		return size;
+	case ReplayCodecLZ:
+		return size + size / 255 + 16;
+	default:
+		return compressBound(size);
+	}
+}
+
+size_t replayUncompressBound(size_t size)
+{
+	return size * 1032 + 64;
+}
+
+size_t replayCompress(ReplayCodec codec, const uint8_t* in, size_t size, uint8_t* out, uint8_t* usedCodec)
+{
+	*usedCodec = codec.id;
+	switch (codec.id)
+	{
+	case ReplayCodecRaw:
+		if (size != 0)
+			memcpy(out, in, size);
+		return size;
+	case ReplayCodecLZ:
+		return lzCompress(in, size, out);
+	default:
+	{
+		uLongf compressedSize = compressBound(size);
+		if (compress2(out, &compressedSize, in, size, codec.level) == Z_OK)
+			return compressedSize;
+		// Out of memory most likely, the chunk still has to go somewhere. compressBound is never less than size
+		*usedCodec = ReplayCodecRaw;
+		if (size != 0)
+			memcpy(out, in, size);
+		return size;
+	}
+	}
+}
+
+bool replayUncompress(uint8_t codec, const uint8_t* in, size_t size, uint8_t* out, size_t outSize)
+{
+	switch (codec)
+	{
+	case ReplayCodecRaw:
+		if (size != outSize)
+			return false;
+		if (size != 0)
+			memcpy(out, in, size);
+		return true;
+	case ReplayCodecLZ:
+		return lzUncompress(in, size, out, outSize);
+	case ReplayCodecZlib:
+	{
+		uLongf uncompressedSize = outSize;
+		return uncompress(out, &uncompressedSize, in, size) == Z_OK && uncompressedSize == outSize;
+	}
+	default:
+		return false;
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+/*
+*	Compression for replay chunks. Every chunk records the codec it was written with (version 18+), so the codec can be changed
+*	with $pref::Rewind::ReplayCodec at any time without breaking replays that are already on disk.
+*
+*	ReplayCodecLZ is a small byte oriented LZ77 in the spirit of LZ4: 4 byte hash matches, no entropy coding.
+*	It compresses a lot less than zlib but runs several times faster, which suits save states and slow machines.
+*/
+enum ReplayCodecId
+{
+	ReplayCodecRaw = 0,
+	ReplayCodecZlib = 1,
+	ReplayCodecLZ = 2
+};
+
+struct ReplayCodec
+{
+	uint8_t id;
+	int level; // zlib only, 1-9 or -1 for zlib's default
+};
+
+// "raw", "lz", "zlib" or "zlib1"-"zlib9". Anything else is zlib at its default level, which is what replays always used
+ReplayCodec parseReplayCodec(std::string name);
+std::string getReplayCodecName(ReplayCodec codec);
+
+size_t replayCompressBound(ReplayCodec codec, size_t size);
+// out has to hold replayCompressBound bytes, returns the compressed size. usedCodec gets the id out has to be uncompressed with,
+// which is raw if zlib failed
+size_t replayCompress(ReplayCodec codec, const uint8_t* in, size_t size, uint8_t* out, uint8_t* usedCodec);
+// The most any codec can turn size bytes into, deflate tops out a little over 1000:1
+size_t replayUncompressBound(size_t size);
+// False unless in decodes to exactly outSize bytes
+bool replayUncompress(uint8_t codec, const uint8_t* in, size_t size, uint8_t* out, size_t outSize);
@@ -0,0 +1,1844 @@
+#include "ReplayFile.h"
+#include <zlib.h>
+#include <cstring>
+#include <algorithm>
+#include <climits>
+#include <stdexcept>
+#include "Logging.h"
+#ifdef WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+std::vector<std::string> SplitStringDelim(std::string str, char delim);
+
+// Version 17+, raw little endian floats instead of the "%f,%f" text
+void write_vector_mpstates(const std::vector<MPState>& list, MemoryStream* f)
+{
+	f->writeInt32(list.size());
+	for (auto& state : list)
+	{
+		float positions[2] = { state.pathPosition, state.targetPosition };
+		f->writeArray(positions, 2);
+	}
+}
+
+std::vector<MPState> read_vector_mpstates(MemoryStream* f)
+{
+	int count = f->readInt32();
+	f->checkRemaining(count, 2 * sizeof(float));
+
+	std::vector<MPState> vec(count);
+	for (int i = 0; i < count; i++)
+	{
+		float positions[2];
+		f->readArray(positions, 2);
+		vec[i].pathPosition = positions[0];
+		vec[i].targetPosition = positions[1];
+		vec[i].pathedInterior = NULL;
+	}
+
+	return vec;
+}
+
+// Only for plain int/float lists, the elements are copied as is
+template<typename T>
+void write_vector(const std::vector<T>& list, MemoryStream* f)
+{
+	f->writeVector(list);
+}
+
+template<typename T>
+std::vector<T> read_vector(MemoryStream* f)
+{
+	std::vector<T> vec;
+	f->readVector(&vec);
+	return vec;
+}
+
+static int getWrittenNamespaceId(int id, const std::vector<int>* namespaceIds)
+{
+	if (id < 0 || namespaceIds == NULL)
+		return id;
+	return (size_t)id < namespaceIds->size() ? (*namespaceIds)[id] : -1;
+}
+
+// States without a namespace have nothing to bind to when they're read back, they'd only come out as id 65535. They're left out
+template<typename T>
+void write_vector_rewindable(const std::vector<RewindableState<T>>& list, MemoryStream* f, const std::vector<int>* namespaceIds)
+{
+	int c = 0;
+	for (auto& state : list)
+	{
+		if (getWrittenNamespaceId(state.namespaceId, namespaceIds) >= 0)
+			c++;
+	}
+	f->writeInt32(c);
+
+	for (auto& state : list)
+	{
+		int id = getWrittenNamespaceId(state.namespaceId, namespaceIds);
+		if (id >= 0)
+			state.write(f, id);
+	}
+}
+
+// Before version 19 every state has its namespace written out in full, it gets interned here
+template<typename T>
+std::vector<RewindableState<T>> read_vector_rewindable(MemoryStream* f, char version, const std::vector<int>* namespaceIds)
+{
+	int c = f->readInt32();
+	bool interned = version >= REPLAY_VERSION_NAMESPACES;
+	// No state is smaller than a bool with its namespace id or its (empty) namespace string
+	f->checkRemaining(c, interned ? sizeof(uint16_t) + 1 : sizeof(uint32_t) + 1);
+
+	std::vector<RewindableState<T>> vec;
+	vec.reserve(c);
+
+	for (int i = 0; i < c; i++)
+	{
+		RewindableState<T> state = RewindableState<T>::read(f, interned);
+		if (interned && namespaceIds != NULL)
+			state.namespaceId = (size_t)state.namespaceId < namespaceIds->size() ? (*namespaceIds)[state.namespaceId] : -1;
+		vec.push_back(state);
+	}
+
+	return vec;
+}
+
+// The old text lists, without their brackets
+static std::string read_list_string(MemoryStream* f)
+{
+	std::string list = f->readString();
+	if (list.size() < 2)
+		throw std::runtime_error("Bad list!");
+	return list.substr(1, list.size() - 2);
+}
+
+std::vector<int> read_list_int(MemoryStream* f)
+{
+	std::string list = read_list_string(f);
+
+	std::vector<std::string> elemlist = SplitStringDelim(list, ',');
+
+	std::vector<int> out;
+
+	for (int i = 0; i < elemlist.size(); i++)
+		out.push_back(atoi(elemlist[i].c_str()));
+
+	return out;
+}
+
+std::vector<int> read_list_powerupstates(MemoryStream* f)
+{
+	std::string list = read_list_string(f);
+
+	std::vector<std::string> elemlist = SplitStringDelim(list, ';');
+
+	std::vector<int> out;
+
+	for (int i = 0; i < elemlist.size(); i++)
+		out.push_back(atoi(elemlist[i].c_str()));
+
+	return out;
+}
+
+std::vector<float> read_list_float(MemoryStream* f)
+{
+	std::string list = read_list_string(f);
+
+	std::vector<std::string> elemlist = SplitStringDelim(list, ',');
+
+	std::vector<float> out;
+
+	for (int i = 0; i < elemlist.size(); i++)
+		out.push_back(atof(elemlist[i].c_str()));
+
+	return out;
+}
+
+std::vector<MPState> read_list_mpstates(MemoryStream* f)
+{
+	std::string list = read_list_string(f);
+	std::vector<std::string> states = SplitStringDelim(list, ';');
+
+	std::vector<MPState> out;
+
+	for (int i = 0; i < states.size(); i++)
+	{
+		MPState s;
+		sscanf(states[i].c_str(), "%f,%f", &s.pathPosition, &s.targetPosition);
+		out.push_back(s);
+	}
+
+	return out;
+
+}
+
+std::vector<std::string> SplitStringDelim(std::string str,char delim)
+{
+	const char* cstr = str.c_str();
+
+	char* inputstr = (char*)malloc(strlen(cstr) + 1);
+	strcpy(inputstr, cstr);
+
+	std::vector<std::string> out;
+
+	char delims[2] = { delim, '\0' };
+	char* splitstr = strtok(inputstr, delims);
+
+	if (splitstr != NULL)
+	{
+		while (splitstr != NULL)
+		{
+			out.push_back(std::string(splitstr));
+			splitstr = strtok(NULL, delims);
+		}
+	}
+
+	free(inputstr);
+	return out;
+}
+
+// Bits of the changed field mask every version 16+ frame starts with
+enum FrameField
+{
+	FieldMs = 1 << 0,
+	FieldDeltaMs = 1 << 1,
+	FieldPosition = 1 << 2,
+	FieldVelocity = 1 << 3,
+	FieldSpin = 1 << 4,
+	FieldPowerup = 1 << 5,
+	FieldTimebonus = 1 << 6,
+	FieldMPStates = 1 << 7,
+	FieldGemcount = 1 << 8,
+	FieldGemstates = 1 << 9,
+	FieldTTStates = 1 << 10,
+	FieldPowerupStates = 1 << 11,
+	FieldGamestate = 1 << 12,
+	FieldLMStates = 1 << 13,
+	FieldNextStateTime = 1 << 14,
+	FieldActivePowStates = 1 << 15,
+	FieldGravityDir = 1 << 16,
+	FieldTrapdoorDirs = 1 << 17,
+	FieldTrapdoorOpen = 1 << 18,
+	FieldTrapdoorClose = 1 << 19,
+	FieldTrapdoorPos = 1 << 20,
+	FieldTeleportState = 1 << 21,
+	FieldEggState = 1 << 22,
+	FieldRewindableInt = 1 << 23,
+	FieldRewindableFloat = 1 << 24,
+	FieldRewindableBool = 1 << 25,
+	FieldRewindableString = 1 << 26,
+	FieldRewindableSOInt = 1 << 27,
+	FieldRewindableSOFloat = 1 << 28,
+	FieldRewindableSOBool = 1 << 29,
+	FieldRewindableSOString = 1 << 30
+};
+
+// Only the fields this build has, the MBP ones aren't part of a frame anywhere else
+static const uint32_t FieldAll = FieldMs | FieldDeltaMs | FieldPosition | FieldVelocity | FieldSpin | FieldPowerup | FieldTimebonus | FieldMPStates
+	| FieldGemcount | FieldGemstates | FieldTTStates | FieldPowerupStates | FieldGamestate | FieldLMStates | FieldNextStateTime | FieldActivePowStates
+	| FieldGravityDir | FieldTrapdoorDirs | FieldTrapdoorOpen | FieldTrapdoorClose | FieldTrapdoorPos
+#ifdef MBP
+	| FieldTeleportState | FieldEggState
+#endif // MBP
+	| FieldRewindableInt | FieldRewindableFloat | FieldRewindableBool | FieldRewindableString
+	| FieldRewindableSOInt | FieldRewindableSOFloat | FieldRewindableSOBool | FieldRewindableSOString;
+
+static bool samePoint(const Point3D& one, const Point3D& two)
+{
+	return one.x == two.x && one.y == two.y && one.z == two.z;
+}
+
+static bool sameMPStates(const std::vector<MPState>& one, const std::vector<MPState>& two)
+{
+	if (one.size() != two.size())
+		return false;
+	for (size_t i = 0; i < one.size(); i++)
+	{
+		if (one[i].pathPosition != two[i].pathPosition || one[i].targetPosition != two[i].targetPosition)
+			return false;
+	}
+	return true;
+}
+
+template<typename T>
+static bool sameRewindableStates(const std::vector<RewindableState<T>>& one, const std::vector<RewindableState<T>>& two)
+{
+	if (one.size() != two.size())
+		return false;
+	for (size_t i = 0; i < one.size(); i++)
+	{
+		if (one[i].value != two[i].value || one[i].namespaceId != two[i].namespaceId)
+			return false;
+	}
+	return true;
+}
+
+static uint32_t getChangedFields(const Frame& frame, const Frame& previous)
+{
+	uint32_t mask = 0;
+	if (frame.ms != previous.ms) mask |= FieldMs;
+	if (frame.deltaMs != previous.deltaMs) mask |= FieldDeltaMs;
+	if (!samePoint(frame.position, previous.position)) mask |= FieldPosition;
+	if (!samePoint(frame.velocity, previous.velocity)) mask |= FieldVelocity;
+	if (!samePoint(frame.spin, previous.spin)) mask |= FieldSpin;
+	if (frame.powerup != previous.powerup) mask |= FieldPowerup;
+	if (frame.timebonus != previous.timebonus) mask |= FieldTimebonus;
+	if (!sameMPStates(frame.mpstates, previous.mpstates)) mask |= FieldMPStates;
+	if (frame.gemcount != previous.gemcount) mask |= FieldGemcount;
+	if (frame.gemstates != previous.gemstates) mask |= FieldGemstates;
+	if (frame.ttstates != previous.ttstates) mask |= FieldTTStates;
+	if (frame.powerupstates != previous.powerupstates) mask |= FieldPowerupStates;
+	if (frame.gamestate != previous.gamestate) mask |= FieldGamestate;
+	if (frame.lmstates != previous.lmstates) mask |= FieldLMStates;
+	if (frame.nextstatetime != previous.nextstatetime) mask |= FieldNextStateTime;
+	if (frame.activepowstates != previous.activepowstates) mask |= FieldActivePowStates;
+	if (frame.gravityDir != previous.gravityDir) mask |= FieldGravityDir;
+	if (frame.trapdoordirs != previous.trapdoordirs) mask |= FieldTrapdoorDirs;
+	if (frame.trapdooropen != previous.trapdooropen) mask |= FieldTrapdoorOpen;
+	if (frame.trapdoorclose != previous.trapdoorclose) mask |= FieldTrapdoorClose;
+	if (frame.trapdoorpos != previous.trapdoorpos) mask |= FieldTrapdoorPos;
+#ifdef MBP
+	if (frame.teleportState.teleportDelay != previous.teleportState.teleportDelay || frame.teleportState.destination != previous.teleportState.destination
+		|| frame.teleportState.teleportCounter != previous.teleportState.teleportCounter) mask |= FieldTeleportState;
+	if (frame.eggstate != previous.eggstate) mask |= FieldEggState;
+#endif // MBP
+	if (!sameRewindableStates(frame.rewindableIntStates, previous.rewindableIntStates)) mask |= FieldRewindableInt;
+	if (!sameRewindableStates(frame.rewindableFloatStates, previous.rewindableFloatStates)) mask |= FieldRewindableFloat;
+	if (!sameRewindableStates(frame.rewindableBoolStates, previous.rewindableBoolStates)) mask |= FieldRewindableBool;
+	if (!sameRewindableStates(frame.rewindableStringStates, previous.rewindableStringStates)) mask |= FieldRewindableString;
+	if (!sameRewindableStates(frame.rewindableSOIntStates, previous.rewindableSOIntStates)) mask |= FieldRewindableSOInt;
+	if (!sameRewindableStates(frame.rewindableSOFloatStates, previous.rewindableSOFloatStates)) mask |= FieldRewindableSOFloat;
+	if (!sameRewindableStates(frame.rewindableSOBoolStates, previous.rewindableSOBoolStates)) mask |= FieldRewindableSOBool;
+	if (!sameRewindableStates(frame.rewindableSOStringStates, previous.rewindableSOStringStates)) mask |= FieldRewindableSOString;
+	return mask;
+}
+
+void writeFrame(const Frame& frame, MemoryStream* m, const Frame* previous, const std::vector<int>* namespaceIds)
+{
+	uint32_t mask = previous == NULL ? FieldAll : getChangedFields(frame, *previous);
+	m->writeUInt32(mask);
+
+	if (mask & FieldMs)
+		m->writeInt32(frame.ms);
+	if (mask & FieldDeltaMs)
+		m->writeInt32(frame.deltaMs);
+	if (mask & FieldPosition)
+		m->writePoint3D(frame.position);
+	if (mask & FieldVelocity)
+		m->writePoint3D(frame.velocity);
+	if (mask & FieldSpin)
+		m->writePoint3D(frame.spin);
+	if (mask & FieldPowerup)
+		m->writeInt32(frame.powerup);
+	if (mask & FieldTimebonus)
+		m->writeInt32(frame.timebonus);
+	if (mask & FieldMPStates)
+		write_vector_mpstates(frame.mpstates, m);
+	if (mask & FieldGemcount)
+		m->writeInt32(frame.gemcount);
+	if (mask & FieldGemstates)
+		write_vector(frame.gemstates, m);
+	if (mask & FieldTTStates)
+		write_vector(frame.ttstates, m);
+	if (mask & FieldPowerupStates)
+		write_vector(frame.powerupstates, m);
+	if (mask & FieldGamestate)
+		m->writeString(frame.gamestate);
+	if (mask & FieldLMStates)
+		write_vector(frame.lmstates, m);
+	if (mask & FieldNextStateTime)
+		m->writeInt32(frame.nextstatetime);
+	if (mask & FieldActivePowStates)
+		write_vector(frame.activepowstates, m);
+	if (mask & FieldGravityDir)
+		m->writeString(frame.gravityDir);
+	if (mask & FieldTrapdoorDirs)
+		write_vector(frame.trapdoordirs, m);
+	if (mask & FieldTrapdoorOpen)
+		write_vector(frame.trapdooropen, m);
+	if (mask & FieldTrapdoorClose)
+		write_vector(frame.trapdoorclose, m);
+	if (mask & FieldTrapdoorPos)
+		write_vector(frame.trapdoorpos, m);
+#ifdef  MBP
+	if (mask & FieldTeleportState)
+	{
+		m->writeInt32(frame.teleportState.teleportDelay);
+		m->writeString(frame.teleportState.destination);
+		m->writeInt32(frame.teleportState.teleportCounter);
+	}
+	if (mask & FieldEggState)
+		m->writeBool(frame.eggstate);
+#endif //  MBP
+	if (mask & FieldRewindableInt)
+		write_vector_rewindable(frame.rewindableIntStates, m, namespaceIds);
+	if (mask & FieldRewindableFloat)
+		write_vector_rewindable(frame.rewindableFloatStates, m, namespaceIds);
+	if (mask & FieldRewindableBool)
+		write_vector_rewindable(frame.rewindableBoolStates, m, namespaceIds);
+	if (mask & FieldRewindableString)
+		write_vector_rewindable(frame.rewindableStringStates, m, namespaceIds);
+
+	if (mask & FieldRewindableSOInt)
+		write_vector_rewindable(frame.rewindableSOIntStates, m, namespaceIds);
+	if (mask & FieldRewindableSOFloat)
+		write_vector_rewindable(frame.rewindableSOFloatStates, m, namespaceIds);
+	if (mask & FieldRewindableSOBool)
+		write_vector_rewindable(frame.rewindableSOBoolStates, m, namespaceIds);
+	if (mask & FieldRewindableSOString)
+		write_vector_rewindable(frame.rewindableSOStringStates, m, namespaceIds);
+}
+
+// Version 16+ frames only carry the fields that changed since the previous frame of the chunk
+static Frame readDeltaFrame(MemoryStream* m, char version, const Frame* previous, const std::vector<int>* namespaceIds)
+{
+	Frame frame;
+	if (previous != NULL)
+		frame = *previous;
+#ifdef MBP
+	else
+	{
+		frame.eggstate = false;
+		frame.teleportState.teleportDelay = 0;
+		frame.teleportState.teleportCounter = 0;
+	}
+	// Yeah uh we arent saving checkpoint states
+	frame.checkpointState = CheckpointState();
+#endif // MBP
+
+	uint32_t mask = m->readUInt32();
+	// Skipping a field we don't know would read everything after it from the wrong place
+	if (mask & ~FieldAll)
+		throw std::runtime_error("Unknown frame fields!");
+	if (mask & FieldMs)
+		frame.ms = m->readInt32();
+	if (mask & FieldDeltaMs)
+		frame.deltaMs = m->readInt32();
+	if (mask & FieldPosition)
+		m->readPoint3D(&frame.position);
+	if (mask & FieldVelocity)
+		m->readPoint3D(&frame.velocity);
+	if (mask & FieldSpin)
+		m->readPoint3D(&frame.spin);
+	if (mask & FieldPowerup)
+		frame.powerup = m->readInt32();
+	if (mask & FieldTimebonus)
+		frame.timebonus = m->readInt32();
+	if (mask & FieldMPStates)
+	{
+		if (version >= REPLAY_VERSION_BINARY_MPSTATES)
+			frame.mpstates = read_vector_mpstates(m);
+		else
+			frame.mpstates = read_list_mpstates(m);
+	}
+	if (mask & FieldGemcount)
+		frame.gemcount = m->readInt32();
+	if (mask & FieldGemstates)
+		frame.gemstates = read_vector<int>(m);
+	if (mask & FieldTTStates)
+		frame.ttstates = read_vector<int>(m);
+	if (mask & FieldPowerupStates)
+		frame.powerupstates = read_vector<int>(m);
+	if (mask & FieldGamestate)
+		frame.gamestate = m->readString();
+	if (mask & FieldLMStates)
+		frame.lmstates = read_vector<int>(m);
+	if (mask & FieldNextStateTime)
+		frame.nextstatetime = m->readInt32();
+	if (mask & FieldActivePowStates)
+		frame.activepowstates = read_vector<int>(m);
+	if (mask & FieldGravityDir)
+		frame.gravityDir = m->readString();
+	if (mask & FieldTrapdoorDirs)
+		frame.trapdoordirs = read_vector<int>(m);
+	if (mask & FieldTrapdoorOpen)
+		frame.trapdooropen = read_vector<int>(m);
+	if (mask & FieldTrapdoorClose)
+		frame.trapdoorclose = read_vector<int>(m);
+	if (mask & FieldTrapdoorPos)
+		frame.trapdoorpos = read_vector<float>(m);
+#ifdef MBP
+	if (mask & FieldTeleportState)
+	{
+		frame.teleportState.teleportDelay = m->readInt32();
+		frame.teleportState.destination = m->readString();
+		frame.teleportState.teleportCounter = m->readInt32();
+	}
+	if (mask & FieldEggState)
+		frame.eggstate = m->readBool();
+#endif // MBP
+	if (mask & FieldRewindableInt)
+		frame.rewindableIntStates = read_vector_rewindable<int>(m, version, namespaceIds);
+	if (mask & FieldRewindableFloat)
+		frame.rewindableFloatStates = read_vector_rewindable<float>(m, version, namespaceIds);
+	if (mask & FieldRewindableBool)
+		frame.rewindableBoolStates = read_vector_rewindable<bool>(m, version, namespaceIds);
+	if (mask & FieldRewindableString)
+		frame.rewindableStringStates = read_vector_rewindable<std::string>(m, version, namespaceIds);
+
+	if (mask & FieldRewindableSOInt)
+		frame.rewindableSOIntStates = read_vector_rewindable<int>(m, version, namespaceIds);
+	if (mask & FieldRewindableSOFloat)
+		frame.rewindableSOFloatStates = read_vector_rewindable<float>(m, version, namespaceIds);
+	if (mask & FieldRewindableSOBool)
+		frame.rewindableSOBoolStates = read_vector_rewindable<bool>(m, version, namespaceIds);
+	if (mask & FieldRewindableSOString)
+		frame.rewindableSOStringStates = read_vector_rewindable<std::string>(m, version, namespaceIds);
+	return frame;
+}
+
+Frame readFrame(MemoryStream* m, char version, const Frame* previous, const std::vector<int>* namespaceIds)
+{
+	if (version >= REPLAY_VERSION_DELTA)
+		return readDeltaFrame(m, version, previous, namespaceIds);
+
+	Frame frame;
+	frame.ms = m->readInt32();
+	frame.deltaMs = m->readInt32();
+	m->readPoint3D(&frame.position);
+	m->readPoint3D(&frame.velocity);
+	m->readPoint3D(&frame.spin);
+	frame.powerup = m->readInt32();
+	frame.timebonus = m->readInt32();
+	frame.mpstates = read_list_mpstates(m);
+	frame.gemcount = m->readInt32();
+
+	if (version >= 7)
+	{
+		frame.gemstates = read_vector<int>(m);
+		frame.ttstates = read_vector<int>(m);
+		frame.powerupstates = read_vector<int>(m);
+	}
+	else
+	{
+		frame.gemstates = read_list_int(m);
+		frame.ttstates = read_list_int(m);
+		frame.powerupstates = read_list_int(m);
+	}
+	frame.gamestate = m->readString();
+	if (version >= 7)
+		frame.lmstates = read_vector<int>(m);
+	else
+		frame.lmstates = read_list_int(m);
+	frame.nextstatetime = m->readInt32();
+
+	if (version >= 7)
+		frame.activepowstates = read_vector<int>(m);
+	else
+		frame.activepowstates = read_list_powerupstates(m);
+	frame.gravityDir = m->readString();
+	if (version >= 5 && version < 7)
+	{
+		frame.trapdoordirs = read_list_int(m);
+		frame.trapdooropen = read_list_int(m);
+		frame.trapdoorclose = read_list_int(m);
+	}
+	if (version >= 6 && version < 7)
+	{
+		frame.trapdoorpos = read_list_float(m);
+	}
+	if (version >= 7)
+	{
+		frame.trapdoordirs = read_vector<int>(m);
+		frame.trapdooropen = read_vector<int>(m);
+		frame.trapdoorclose = read_vector<int>(m);
+		frame.trapdoorpos = read_vector<float>(m);
+	}
+#ifdef MBP
+	if (version >= 8)
+	{
+		frame.teleportState.teleportDelay = m->readInt32();
+		frame.teleportState.destination = m->readString();
+		if (version >= 9)
+			frame.teleportState.teleportCounter = m->readInt32();
+	}
+	frame.eggstate = false;
+	if (version >= 12)
+		frame.eggstate = m->readBool();
+	// Yeah uh we arent saving checkpoint states
+	frame.checkpointState = CheckpointState();
+#endif // MBP
+
+	if (version == 10)
+	{
+		m->readInt32();
+		m->readInt32();
+	}
+	if (version >= 11)
+	{
+		frame.rewindableIntStates = read_vector_rewindable<int>(m, version, NULL);
+		frame.rewindableFloatStates = read_vector_rewindable<float>(m, version, NULL);
+		frame.rewindableBoolStates = read_vector_rewindable<bool>(m, version, NULL);
+		frame.rewindableStringStates = read_vector_rewindable<std::string>(m, version, NULL);
+
+		frame.rewindableSOIntStates = read_vector_rewindable<int>(m, version, NULL);
+		frame.rewindableSOFloatStates = read_vector_rewindable<float>(m, version, NULL);
+		frame.rewindableSOBoolStates = read_vector_rewindable<bool>(m, version, NULL);
+		frame.rewindableSOStringStates = read_vector_rewindable<std::string>(m, version, NULL);
+	}
+	return frame;
+}
+
+static uint32_t readUInt32LE(const uint8_t* bytes)
+{
+	return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+static bool readFileUInt32(FILE* f, uint32_t* out)
+{
+	uint8_t bytes[4];
+	if (fread(bytes, 1, 4, f) != 4)
+		return false;
+	*out = readUInt32LE(bytes);
+	return true;
+}
+
+// Throws unless count more bytes are left in f, like MemoryStream::checkRemaining. Sizes read from a broken replay can't
+// allocate more than the file holds that way
+static void checkFileRemaining(FILE* f, uint64_t count)
+{
+	long position = ftell(f);
+	if (position < 0 || fseek(f, 0, SEEK_END) != 0)
+		throw std::runtime_error("End of file!");
+	long end = ftell(f);
+	if (fseek(f, position, SEEK_SET) != 0 || end < position || count > (uint64_t)(end - position))
+		throw std::runtime_error("End of file!");
+}
+
+static bool readFileString(FILE* f, std::string* out)
+{
+	uint32_t len;
+	if (!readFileUInt32(f, &len))
+		return false;
+	checkFileRemaining(f, len);
+	out->resize(len);
+	if (len != 0 && fread(&(*out)[0], 1, len, f) != len)
+		return false;
+	return true;
+}
+
+bool readReplayHeader(FILE* f, ReplayHeader* header)
+{
+	int version = fgetc(f);
+	if (version == EOF || version > REPLAY_VERSION)
+		return false;
+	header->version = version;
+	if (!readFileUInt32(f, &header->indexOffset))
+		return false;
+	header->frameCount = 0;
+	header->finalTime = 0;
+	header->totalElapsed = 0;
+	header->checksum = 0;
+	if (version >= REPLAY_VERSION_HEADER)
+	{
+		uint32_t finalTime, totalElapsed;
+		if (!readFileUInt32(f, &header->frameCount) || !readFileUInt32(f, &finalTime) || !readFileUInt32(f, &totalElapsed) || !readFileUInt32(f, &header->checksum))
+			return false;
+		header->finalTime = (int)finalTime;
+		header->totalElapsed = (int)totalElapsed;
+	}
+	if (!readFileString(f, &header->mission))
+		return false;
+	if (!readFileString(f, &header->game))
+		return false;
+	header->namespaces.clear();
+	return true;
+}
+
+std::vector<int> internReplayNamespaces(const ReplayHeader& header)
+{
+	std::vector<int> ids;
+	ids.reserve(header.namespaces.size());
+	for (auto& ns : header.namespaces)
+		ids.push_back(internRewindableNamespace(ns));
+	return ids;
+}
+
+// The replay was never finished, walk the chunks that made it to disk whole instead.
+// f has to be right after the header and is left right after the last complete chunk
+static bool salvageReplayChunks(FILE* f, ReplayHeader* header, std::vector<ReplayChunkInfo>* chunks)
+{
+	header->frameCount = 0;
+	header->finalTime = 0;
+	header->totalElapsed = 0;
+	header->checksum = crc32(0L, Z_NULL, 0);
+	header->namespaces.clear();
+
+	MemoryStream m;
+	ReplayChunkData data;
+	while (true)
+	{
+		ReplayChunkInfo info;
+		info.offset = ftell(f);
+		// A crash leaves at most one torn chunk at the end, zlib's own checksum tells us where that starts
+		uint32_t checksum = header->checksum;
+		int count;
+		try
+		{
+			count = readReplayChunkData(f, header->version, &data, &checksum) ? uncompressReplayChunk(data, &m) : -1;
+		}
+		catch (std::runtime_error&)
+		{
+			// Sizes that run past the end of the file, torn just the same
+			count = -1;
+		}
+		if (count <= 0)
+		{
+			fseek(f, info.offset, SEEK_SET);
+			break;
+		}
+
+		// Frames that don't decode end the replay just like a torn chunk
+		info.frameCount = count;
+		info.firstFrame = header->frameCount;
+		int totalElapsed = header->totalElapsed;
+		int finalTime = header->finalTime;
+		try
+		{
+			Frame previous;
+			for (int i = 0; i < count; i++)
+			{
+				Frame frame = readFrame(&m, header->version, i == 0 ? NULL : &previous);
+				totalElapsed += frame.deltaMs;
+				finalTime = frame.ms;
+				if (i == 0)
+				{
+					info.startMs = frame.ms;
+					info.startElapsed = totalElapsed;
+				}
+				previous = frame;
+			}
+		}
+		catch (std::runtime_error&)
+		{
+			fseek(f, info.offset, SEEK_SET);
+			break;
+		}
+		header->checksum = checksum;
+		header->namespaces.insert(header->namespaces.end(), data.namespaces.begin(), data.namespaces.end());
+		header->totalElapsed = totalElapsed;
+		header->finalTime = finalTime;
+		header->frameCount += count;
+		chunks->push_back(info);
+	}
+	return chunks->size() != 0;
+}
+
+bool readReplayChunkIndex(FILE* f, ReplayHeader* header, std::vector<ReplayChunkInfo>* chunks)
+{
+	chunks->clear();
+	if (header->indexOffset == 0)
+		return salvageReplayChunks(f, header, chunks);
+
+	fseek(f, header->indexOffset, SEEK_SET);
+	uint32_t count;
+	if (!readFileUInt32(f, &count))
+		return false;
+	int firstFrame = 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		ReplayChunkInfo info;
+		if (!readFileUInt32(f, &info.offset) || !readFileUInt32(f, &info.frameCount))
+			return false;
+		info.startMs = 0;
+		info.startElapsed = 0;
+		if (header->version >= REPLAY_VERSION_INDEXED)
+		{
+			uint32_t startMs, startElapsed;
+			if (!readFileUInt32(f, &startMs) || !readFileUInt32(f, &startElapsed))
+				return false;
+			info.startMs = startMs;
+			info.startElapsed = startElapsed;
+		}
+		info.firstFrame = firstFrame;
+		firstFrame += info.frameCount;
+		chunks->push_back(info);
+	}
+
+	header->namespaces.clear();
+	if (header->version >= REPLAY_VERSION_NAMESPACES)
+	{
+		// Past the total frame count
+		uint32_t frameCount, namespaceCount;
+		if (!readFileUInt32(f, &frameCount) || !readFileUInt32(f, &namespaceCount))
+			return false;
+		for (uint32_t i = 0; i < namespaceCount; i++)
+		{
+			std::string ns;
+			if (!readFileString(f, &ns))
+				return false;
+			header->namespaces.push_back(ns);
+		}
+	}
+	return true;
+}
+
+int readReplayVersion(FILE* f)
+{
+	// As an int, a char would turn EOF and anything from 0x80 up into versions below REPLAY_VERSION_CHUNKED
+	int version = fgetc(f);
+	fseek(f, 0, SEEK_SET);
+	if (version == EOF || version > REPLAY_VERSION)
+		return -1;
+	return version;
+}
+
+int openLegacyReplay(std::string path, MappedFile* file, MemoryStream* m)
+{
+	if (!file->open(path))
+		return -1;
+
+	m->borrowBuffer(file->getData(), file->getSize());
+	char version = m->readChar();
+	if (version < 2)
+		return version; // Uncompressed, frames get read right out of the mapping
+
+	uLongf uncompressedSize = 52428800; //max uncompressed data size - 50mb, bad idea but replays prob wont go over this
+	if (version >= 3)
+		uncompressedSize = m->readUInt32();
+
+	const uint8_t* compressed = file->getData() + m->tell();
+	uLong compressedSize = file->getSize() - m->tell();
+	if (uncompressedSize > replayUncompressBound(compressedSize))
+		return -1;
+	if (uncompress(m->allocate(uncompressedSize), &uncompressedSize, compressed, compressedSize) != Z_OK)
+		return -1;
+	// Trim the stream to what actually came out, the data stays where it is
+	m->allocate(uncompressedSize);
+	return version;
+}
+
+bool readReplayChunkData(FILE* f, char version, ReplayChunkData* chunk, uint32_t* checksum)
+{
+	uint8_t header[17];
+	size_t headerSize = version >= REPLAY_VERSION_NAMESPACES ? 17 : version >= REPLAY_VERSION_CODECS ? 13 : 12;
+	if (fread(header, 1, headerSize, f) != headerSize)
+		return false;
+	chunk->frameCount = readUInt32LE(header);
+	chunk->uncompressedSize = readUInt32LE(header + 4);
+	uint32_t compressedSize = readUInt32LE(header + 8);
+	chunk->codec = ReplayCodecZlib;
+	if (version >= REPLAY_VERSION_CODECS)
+		chunk->codec = header[12];
+
+	uint32_t namesSize = version >= REPLAY_VERSION_NAMESPACES ? readUInt32LE(header + 13) : 0;
+	checkFileRemaining(f, (uint64_t)namesSize + compressedSize);
+
+	chunk->namespaces.clear();
+	std::vector<uint8_t> names;
+	if (version >= REPLAY_VERSION_NAMESPACES)
+	{
+		names.resize(namesSize);
+		if (names.size() < sizeof(uint32_t) || fread(names.data(), 1, names.size(), f) != names.size())
+			return false;
+		MemoryStream m;
+		m.borrowBuffer(names.data(), names.size());
+		try
+		{
+			uint32_t count = m.readUInt32();
+			for (uint32_t i = 0; i < count; i++)
+				chunk->namespaces.push_back(m.readString());
+		}
+		catch (std::runtime_error&)
+		{
+			return false;
+		}
+	}
+
+	chunk->compressed.resize(compressedSize);
+	if (fread(chunk->compressed.data(), 1, compressedSize, f) != compressedSize)
+		return false;
+	if (checksum != NULL)
+	{
+		*checksum = crc32(*checksum, header, headerSize);
+		if (!names.empty())
+			*checksum = crc32(*checksum, names.data(), names.size());
+		*checksum = crc32(*checksum, chunk->compressed.data(), compressedSize);
+	}
+	return true;
+}
+
+int uncompressReplayChunk(const ReplayChunkData& chunk, MemoryStream* out)
+{
+	// Sizes no chunk could have, every frame starts with at least 4 bytes
+	if (chunk.uncompressedSize > replayUncompressBound(chunk.compressed.size()) || chunk.frameCount > chunk.uncompressedSize / sizeof(uint32_t))
+		return -1;
+	// Uncompress right into the stream instead of going through another buffer
+	if (!replayUncompress(chunk.codec, chunk.compressed.data(), chunk.compressed.size(), out->allocate(chunk.uncompressedSize), chunk.uncompressedSize))
+		return -1;
+	return chunk.frameCount;
+}
+
+int readReplayChunk(FILE* f, char version, MemoryStream* out, uint32_t* checksum)
+{
+	ReplayChunkData chunk;
+	if (!readReplayChunkData(f, version, &chunk, checksum))
+		return -1;
+	return uncompressReplayChunk(chunk, out);
+}
+
+bool readReplayChunks(FILE* f, const ReplayHeader& header, const std::vector<ReplayChunkInfo>& chunks, ThreadPool* pool, std::function<void(int index, std::vector<Frame>& frames)> onChunk)
+{
+	char version = header.version;
+	std::vector<int> namespaceIds = internReplayNamespaces(header);
+	// The file is read on this thread a batch at a time, which also keeps only a few chunks worth of frames decoded at once
+	int batchSize = pool != NULL ? pool->getThreadCount() * 2 : 1;
+	std::vector<ReplayChunkData> data(batchSize);
+	std::vector<std::vector<Frame>> frames(batchSize);
+	std::vector<char> decoded(batchSize);
+	auto decode = [&](int i)
+	{
+		MemoryStream m;
+		int count = uncompressReplayChunk(data[i], &m);
+		frames[i].clear();
+		frames[i].reserve(std::max(count, 0));
+		try
+		{
+			for (int j = 0; j < count; j++)
+				frames[i].push_back(readFrame(&m, version, j == 0 ? NULL : &frames[i].back(), &namespaceIds));
+			decoded[i] = count == (int)data[i].frameCount;
+		}
+		catch (std::runtime_error&)
+		{
+			decoded[i] = false;
+		}
+	};
+
+	for (size_t first = 0; first < chunks.size(); first += batchSize)
+	{
+		int count = std::min((size_t)batchSize, chunks.size() - first);
+		for (int i = 0; i < count; i++)
+		{
+			fseek(f, chunks[first + i].offset, SEEK_SET);
+			try
+			{
+				if (!readReplayChunkData(f, version, &data[i]))
+					return false;
+			}
+			catch (std::runtime_error&)
+			{
+				return false;
+			}
+		}
+
+		if (pool != NULL)
+			pool->parallelFor(count, decode);
+		else
+			decode(0);
+
+		// Everything up to a broken chunk still goes out, nothing after it
+		for (int i = 0; i < count; i++)
+		{
+			if (!decoded[i])
+				return false;
+			onChunk(first + i, frames[i]);
+		}
+	}
+	return true;
+}
+
+bool analyzeReplayFile(std::string path, ReplayInfo* info)
+{
+	info->replayPath = path;
+	info->replayMission = std::string("[null]");
+	info->replayGame = std::string("[null]");
+	info->elapsedTime = 0;
+	info->time = 0;
+	info->checksum = 0;
+	info->version = 0;
+	info->frameCount = 0;
+
+	FILE* f = fopen(path.c_str(), "rb");
+	if (f == NULL)
+		return false;
+
+	int readVersion = readReplayVersion(f);
+	if (readVersion == -1)
+	{
+		fclose(f);
+		return false;
+	}
+	char version = readVersion;
+
+	if (version >= REPLAY_VERSION_CHUNKED)
+	{
+		ReplayHeader header;
+		std::vector<ReplayChunkInfo> chunks;
+		info->version = version;
+		bool ok = true;
+		if (!readReplayHeader(f, &header))
+		{
+			ok = false;
+		}
+		else if (version >= REPLAY_VERSION_HEADER && header.indexOffset != 0)
+		{
+			// Everything we need is in the header, no need to touch the frames
+			info->replayMission = header.mission;
+			info->replayGame = header.game;
+			info->frameCount = header.frameCount;
+			info->time = header.finalTime;
+			info->elapsedTime = header.totalElapsed;
+			info->checksum = header.checksum;
+		}
+		else if (readReplayChunkIndex(f, &header, &chunks))
+		{
+			info->replayMission = header.mission;
+			info->replayGame = header.game;
+
+			// A chunk that doesn't read ends the replay, like it does for playback
+			MemoryStream m;
+			for (auto& chunk : chunks)
+			{
+				fseek(f, chunk.offset, SEEK_SET);
+				int count = readReplayChunk(f, version, &m);
+				if (count != (int)chunk.frameCount)
+					break;
+				Frame previous;
+				for (int i = 0; i < count; i++)
+				{
+					Frame frame = readFrame(&m, version, i == 0 ? NULL : &previous);
+					previous = frame;
+					info->time = frame.ms; // The newest frame is last
+					info->elapsedTime += frame.deltaMs;
+				}
+				info->frameCount += count;
+			}
+		}
+		else
+		{
+			ok = false;
+		}
+		fclose(f);
+		return ok;
+	}
+
+	fclose(f);
+
+	MappedFile file;
+	MemoryStream m;
+	version = openLegacyReplay(path, &file, &m);
+	info->version = version;
+	if (version == -1)
+		return false;
+
+	int framecount = m.readInt32();
+	info->frameCount = framecount;
+	if (version >= 4)
+		info->replayMission = m.readString();
+	if (version >= 10)
+		info->replayGame = m.readString();
+
+	for (int i = 0; i < framecount; i++)
+	{
+		Frame frame = readFrame(&m, version);
+
+		if (i == 0)
+			info->time = frame.ms;
+		info->elapsedTime += frame.deltaMs;
+
+		if (m.tell() >= m.length()) break;
+	}
+	return true;
+}
+
+// False on a short write, eg. when the disk is full
+static bool writeFile(FILE* f, const void* data, size_t size)
+{
+	return size == 0 || fwrite(data, 1, size, f) == size;
+}
+
+static bool syncFile(FILE* f)
+{
+	if (fflush(f) != 0)
+		return false;
+#ifdef WIN32
+	return _commit(_fileno(f)) == 0;
+#else
+	return fsync(fileno(f)) == 0;
+#endif
+}
+
+static bool truncateFile(FILE* f, long size)
+{
+	fflush(f);
+#ifdef WIN32
+	return _chsize_s(_fileno(f), size) == 0;
+#else
+	return ftruncate(fileno(f), size) == 0;
+#endif
+}
+
+// Swaps from in for to in one go, so a crash leaves either the old file or the new one but never half of one
+bool replaceFile(std::string from, std::string to)
+{
+#ifdef WIN32
+	return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	return rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+static void writeReplayIndex(const std::vector<ReplayChunkInfo>& chunks, uint32_t bodyOffset, int frameCount, const std::vector<std::string>& namespaces, MemoryStream* m)
+{
+	m->writeUInt32(chunks.size());
+	for (auto& info : chunks)
+	{
+		m->writeUInt32(bodyOffset + info.offset);
+		m->writeUInt32(info.frameCount);
+		m->writeInt32(info.startMs);
+		m->writeInt32(info.startElapsed);
+	}
+	m->writeUInt32(frameCount);
+	m->writeUInt32(namespaces.size());
+	for (auto& ns : namespaces)
+		m->writeString(ns);
+}
+
+static void writeReplayHeader(const ReplayHeader& header, MemoryStream* m)
+{
+	m->writeChar(header.version);
+	m->writeUInt32(header.indexOffset);
+	m->writeUInt32(header.frameCount);
+	m->writeInt32(header.finalTime);
+	m->writeInt32(header.totalElapsed);
+	m->writeUInt32(header.checksum);
+	m->writeString(header.mission);
+	m->writeString(header.game);
+}
+
+ReplayWriter::ReplayWriter()
+{
+	this->journal = NULL;
+	this->codec = parseReplayCodec("zlib");
+	clear();
+}
+
+ReplayWriter::~ReplayWriter()
+{
+	// Whatever made it into the journal stays there to be salvaged
+	closeJournal(false);
+}
+
+static bool fileExists(const std::string& path)
+{
+	FILE* f = fopen(path.c_str(), "rb");
+	if (f == NULL)
+		return false;
+	fclose(f);
+	return true;
+}
+
+// foo.rwx.partial recovers to foo-recovered.rwx, or foo-recovered2.rwx and so on if that's taken
+static std::string getRecoveredReplayPath(std::string journalPath)
+{
+	std::string path = journalPath.substr(0, journalPath.size() - strlen(REPLAY_PARTIAL_EXTENSION));
+	size_t dot = path.rfind('.');
+	size_t slash = path.find_last_of("/\\");
+	if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+		dot = path.size();
+	std::string recovered;
+	for (int i = 1; ; i++)
+	{
+		recovered = path.substr(0, dot) + "-recovered" + (i == 1 ? std::string() : std::to_string(i)) + path.substr(dot);
+		if (!fileExists(recovered) && !fileExists(recovered + REPLAY_PARTIAL_EXTENSION))
+			return recovered;
+	}
+}
+
+bool ReplayWriter::openJournal(std::string path, std::string mission, std::string game)
+{
+	closeJournal(true);
+	// Whatever is still there is the journal of a run that crashed, it gets finished off next to it instead of being overwritten.
+	// If it can't be, it's moved out of the way as it is so loading the recovered name still salvages it
+	if (fileExists(path))
+	{
+		std::string recovered = getRecoveredReplayPath(path);
+		if (!recoverReplay(path, recovered) && !replaceFile(path, recovered + REPLAY_PARTIAL_EXTENSION))
+			return false;
+	}
+	this->journal = fopen(path.c_str(), "wb");
+	if (this->journal == NULL)
+		return false;
+
+	// Index offset 0 marks the replay as unfinished, the chunks get salvaged when it's loaded
+	ReplayHeader header;
+	header.version = REPLAY_VERSION;
+	header.indexOffset = 0;
+	header.frameCount = 0;
+	header.finalTime = 0;
+	header.totalElapsed = 0;
+	header.checksum = 0;
+	header.mission = mission;
+	header.game = game;
+	MemoryStream headerStream;
+	writeReplayHeader(header, &headerStream);
+	// Chunks that were compressed before the journal got opened go in too
+	if (!writeFile(this->journal, headerStream.getBuffer(), headerStream.length()) || !writeFile(this->journal, this->body.data(), this->body.size())
+		|| fflush(this->journal) != 0)
+	{
+		fclose(this->journal);
+		this->journal = NULL;
+		::remove(path.c_str());
+		return false;
+	}
+
+	this->journalPath = path;
+	this->journalMission = mission;
+	this->journalGame = game;
+	this->journalBodyOffset = headerStream.length();
+	return true;
+}
+
+void ReplayWriter::closeJournal(bool remove)
+{
+	if (this->journal == NULL)
+		return;
+
+	fclose(this->journal);
+	this->journal = NULL;
+	if (remove)
+		::remove(this->journalPath.c_str());
+}
+
+void ReplayWriter::clear()
+{
+	closeJournal(true);
+	this->chunk.clear();
+	this->chunkFrames.clear();
+	this->chunkFrameOffsets.clear();
+	this->body.clear();
+	this->chunks.clear();
+	this->chunkChecksums.clear();
+	this->namespaces.clear();
+	this->namespaceIds.clear();
+	this->localNamespaceIds.clear();
+	this->chunkNamespaceStarts.clear();
+	this->writtenNamespaces = 0;
+	this->skipped.clear();
+	this->frameCount = 0;
+	this->elapsedTime = 0;
+	this->checksum = crc32(0L, Z_NULL, 0);
+}
+
+void ReplayWriter::addNamespace(int id)
+{
+	if (id < 0)
+		return;
+	if ((size_t)id >= this->localNamespaceIds.size())
+		this->localNamespaceIds.resize(id + 1, -1);
+	if (this->localNamespaceIds[id] != -1)
+		return;
+	this->localNamespaceIds[id] = this->namespaces.size();
+	this->namespaces.push_back(getRewindableNamespace(id));
+	this->namespaceIds.push_back(id);
+}
+
+template<typename T>
+void ReplayWriter::addNamespaces(const std::vector<RewindableState<T>>& states)
+{
+	for (auto& state : states)
+		addNamespace(state.namespaceId);
+}
+
+void ReplayWriter::addNamespaces(const Frame& frame)
+{
+	addNamespaces(frame.rewindableIntStates);
+	addNamespaces(frame.rewindableFloatStates);
+	addNamespaces(frame.rewindableBoolStates);
+	addNamespaces(frame.rewindableStringStates);
+	addNamespaces(frame.rewindableSOIntStates);
+	addNamespaces(frame.rewindableSOFloatStates);
+	addNamespaces(frame.rewindableSOBoolStates);
+	addNamespaces(frame.rewindableSOStringStates);
+}
+
+void ReplayWriter::writeFrame(const Frame& frame)
+{
+	if (frame.deltaMs < 0) // Loading throws these away anyway, leaving them out keeps the index in step with what gets loaded
+	{
+		this->skipped.push_back(this->frameCount + this->skipped.size());
+		return;
+	}
+
+	// Full chunks only get compressed once the next frame shows up, so taking back a few frames across a chunk boundary stays cheap
+	if (this->chunkFrames.size() >= REPLAY_CHUNK_FRAMES)
+		flushChunk();
+
+	// Every chunk starts with a keyframe so it can be decoded without the ones before it
+	addNamespaces(frame);
+	this->chunkFrameOffsets.push_back(this->chunk.length());
+	::writeFrame(frame, &this->chunk, this->chunkFrames.empty() ? NULL : &this->chunkFrames.back(), &this->localNamespaceIds);
+	this->chunkFrames.push_back(frame);
+	this->elapsedTime += frame.deltaMs;
+	this->frameCount++;
+}
+
+void ReplayWriter::truncate(int count)
+{
+	while (!this->skipped.empty() && this->skipped.back() >= count)
+		this->skipped.pop_back();
+	count -= this->skipped.size();
+	if (count >= this->frameCount)
+		return;
+
+	// The cut is in a chunk that was already compressed, drop everything after it and bring it back
+	while (count < this->frameCount - (int)this->chunkFrames.size())
+	{
+		dropLastFrames(this->chunkFrames.size());
+		reopenLastChunk();
+	}
+	dropLastFrames(this->frameCount - count);
+	// Keeps the last frame around for the header
+	if (this->chunkFrames.empty() && !this->chunks.empty())
+		reopenLastChunk();
+}
+
+void ReplayWriter::dropLastFrames(int count)
+{
+	if (count <= 0)
+		return;
+
+	this->chunk.truncate(this->chunkFrameOffsets[this->chunkFrameOffsets.size() - count]);
+	for (int i = 0; i < count; i++)
+	{
+		this->elapsedTime -= this->chunkFrames.back().deltaMs;
+		this->chunkFrames.pop_back();
+		this->chunkFrameOffsets.pop_back();
+		this->frameCount--;
+	}
+}
+
+void ReplayWriter::reopenLastChunk()
+{
+	const ReplayChunkInfo& info = this->chunks.back();
+	MemoryStream header;
+	header.borrowBuffer(&this->body[info.offset], 4 * sizeof(uint32_t) + 1);
+	uint32_t count = header.readUInt32();
+	uint32_t uncompressedSize = header.readUInt32();
+	uint32_t compressedSize = header.readUInt32();
+	uint8_t codec = header.readUInt8();
+	uint32_t namesSize = header.readUInt32();
+	replayUncompress(codec, &this->body[info.offset + header.length() + namesSize], compressedSize, this->chunk.allocate(uncompressedSize), uncompressedSize);
+
+	// The frames go back to the ids of this process, the namespaces the chunk added stay in the table and get written with it again
+	this->chunkFrames.clear();
+	this->chunkFrameOffsets.clear();
+	for (uint32_t i = 0; i < count; i++)
+	{
+		this->chunkFrameOffsets.push_back(this->chunk.tell());
+		this->chunkFrames.push_back(readFrame(&this->chunk, REPLAY_VERSION, i == 0 ? NULL : &this->chunkFrames.back(), &this->namespaceIds));
+	}
+	this->writtenNamespaces = this->chunkNamespaceStarts.back();
+	this->chunkNamespaceStarts.pop_back();
+
+	if (this->journal != NULL && (!truncateFile(this->journal, this->journalBodyOffset + info.offset) || fseek(this->journal, this->journalBodyOffset + info.offset, SEEK_SET) != 0))
+		closeJournal(true);
+	this->body.resize(info.offset);
+	this->checksum = this->chunkChecksums.back();
+	this->chunks.pop_back();
+	this->chunkChecksums.pop_back();
+}
+
+void ReplayWriter::flushChunk()
+{
+	if (this->chunkFrames.empty())
+		return;
+
+	this->compressed.resize(replayCompressBound(this->codec, this->chunk.length()));
+	uint8_t codec;
+	uint32_t compressedSize = replayCompress(this->codec, this->chunk.getBuffer(), this->chunk.length(), this->compressed.data(), &codec);
+
+	ReplayChunkInfo info;
+	info.frameCount = this->chunkFrames.size();
+	info.startMs = this->chunkFrames[0].ms;
+	// Elapsed time as of the first frame of the chunk
+	info.startElapsed = this->elapsedTime;
+	for (size_t i = 1; i < this->chunkFrames.size(); i++)
+		info.startElapsed -= this->chunkFrames[i].deltaMs;
+	info.firstFrame = this->frameCount - this->chunkFrames.size();
+	appendChunk(info, this->chunk.length(), codec, this->compressed.data(), compressedSize);
+
+	this->chunk.clear();
+	this->chunkFrames.clear();
+	this->chunkFrameOffsets.clear();
+}
+
+// The frames of the chunk have to be counted in frameCount and elapsedTime already
+void ReplayWriter::appendChunk(ReplayChunkInfo info, uint32_t uncompressedSize, uint8_t codec, const uint8_t* data, uint32_t compressedSize)
+{
+	info.offset = this->body.size();
+	this->chunks.push_back(info);
+	this->chunkChecksums.push_back(this->checksum);
+
+	// Namespaces that got into the table since the last chunk go along with this one, so the journal never has to be rewritten for them
+	MemoryStream names;
+	names.writeUInt32(this->namespaces.size() - this->writtenNamespaces);
+	for (size_t i = this->writtenNamespaces; i < this->namespaces.size(); i++)
+		names.writeString(this->namespaces[i]);
+	this->chunkNamespaceStarts.push_back(this->writtenNamespaces);
+	this->writtenNamespaces = this->namespaces.size();
+
+	MemoryStream header;
+	header.writeUInt32(info.frameCount);
+	header.writeUInt32(uncompressedSize);
+	header.writeUInt32(compressedSize);
+	header.writeUInt8(codec);
+	header.writeUInt32(names.length());
+	this->body.insert(this->body.end(), header.getBuffer(), header.getBuffer() + header.length());
+	this->body.insert(this->body.end(), names.getBuffer(), names.getBuffer() + names.length());
+	this->body.insert(this->body.end(), data, data + compressedSize);
+	this->checksum = crc32(this->checksum, header.getBuffer(), header.length());
+	this->checksum = crc32(this->checksum, names.getBuffer(), names.length());
+	this->checksum = crc32(this->checksum, data, compressedSize);
+	// A journal missing a chunk is no good to save from, save writes the replay out from body instead then
+	if (this->journal != NULL && (!writeFile(this->journal, header.getBuffer(), header.length()) || !writeFile(this->journal, names.getBuffer(), names.length())
+		|| !writeFile(this->journal, data, compressedSize) || fflush(this->journal) != 0))
+		closeJournal(true);
+}
+
+void ReplayWriter::writeFrames(const FrameStore& frames, ThreadPool* pool)
+{
+	// Top up the chunk that's already open first, everything after that starts on a chunk boundary
+	int next = 0;
+	Frame frame;
+	for (; next < frames.size() && (this->chunkFrames.size() < REPLAY_CHUNK_FRAMES || pool == NULL); next++)
+	{
+		frames.get(next, &frame);
+		writeFrame(frame);
+	}
+	if (next == frames.size())
+		return;
+
+	std::vector<int> kept;
+	int callIndex = this->frameCount + this->skipped.size();
+	for (int i = next; i < frames.size(); i++, callIndex++)
+	{
+		if (frames.getDeltaMs(i) < 0)
+			this->skipped.push_back(callIndex);
+		else
+			kept.push_back(i);
+	}
+
+	// The chunks get encoded in parallel, so every namespace they could use goes in the table up front
+	std::vector<bool> usedNamespaces;
+	frames.markRewindableNamespaces(&usedNamespaces);
+	for (size_t id = 0; id < usedNamespaces.size(); id++)
+	{
+		if (usedNamespaces[id])
+			addNamespace(id);
+	}
+
+	// The last chunk stays open like it would with writeFrame, so it can still be truncated cheaply
+	int fullChunks = kept.empty() ? 0 : (kept.size() - 1) / REPLAY_CHUNK_FRAMES;
+	if (fullChunks != 0)
+		flushChunk();
+
+	struct EncodedChunk
+	{
+		ReplayChunkInfo info;
+		int duration;
+		uint32_t uncompressedSize;
+		uint8_t codec;
+		std::vector<uint8_t> compressed;
+	};
+	int batchSize = pool->getThreadCount() * 2;
+	std::vector<EncodedChunk> encoded(batchSize);
+	ReplayCodec codec = this->codec;
+	for (int first = 0; first < fullChunks; first += batchSize)
+	{
+		int count = std::min(batchSize, fullChunks - first);
+		pool->parallelFor(count, [&](int i)
+		{
+			EncodedChunk& out = encoded[i];
+			MemoryStream m;
+			Frame current, previous;
+			out.duration = 0;
+			for (int j = 0; j < REPLAY_CHUNK_FRAMES; j++)
+			{
+				frames.get(kept[(first + i) * REPLAY_CHUNK_FRAMES + j], &current);
+				::writeFrame(current, &m, j == 0 ? NULL : &previous, &this->localNamespaceIds);
+				if (j == 0)
+				{
+					out.info.startMs = current.ms;
+					out.info.startElapsed = current.deltaMs;
+				}
+				out.duration += current.deltaMs;
+				std::swap(current, previous);
+			}
+			out.info.frameCount = REPLAY_CHUNK_FRAMES;
+			out.uncompressedSize = m.length();
+			out.compressed.resize(replayCompressBound(codec, m.length()));
+			out.compressed.resize(replayCompress(codec, m.getBuffer(), m.length(), out.compressed.data(), &out.codec));
+		});
+
+		for (int i = 0; i < count; i++)
+		{
+			EncodedChunk& chunk = encoded[i];
+			chunk.info.startElapsed += this->elapsedTime;
+			chunk.info.firstFrame = this->frameCount;
+			this->elapsedTime += chunk.duration;
+			this->frameCount += chunk.info.frameCount;
+			appendChunk(chunk.info, chunk.uncompressedSize, chunk.codec, chunk.compressed.data(), chunk.compressed.size());
+		}
+	}
+
+	// Skipped frames were already accounted for above
+	for (size_t i = fullChunks * REPLAY_CHUNK_FRAMES; i < kept.size(); i++)
+	{
+		if (this->chunkFrames.size() >= REPLAY_CHUNK_FRAMES)
+			flushChunk();
+		frames.get(kept[i], &frame);
+		this->chunkFrameOffsets.push_back(this->chunk.length());
+		::writeFrame(frame, &this->chunk, this->chunkFrames.empty() ? NULL : &this->chunkFrames.back(), &this->localNamespaceIds);
+		this->chunkFrames.push_back(frame);
+		this->elapsedTime += frame.deltaMs;
+		this->frameCount++;
+	}
+}
+
+bool ReplayWriter::save(std::string path, std::string mission, std::string game)
+{
+	ReplayHeader header;
+	header.version = REPLAY_VERSION;
+	header.indexOffset = 0;
+	header.frameCount = this->frameCount;
+	header.finalTime = this->chunkFrames.empty() ? 0 : this->chunkFrames.back().ms;
+	header.totalElapsed = this->elapsedTime;
+	header.mission = mission;
+	header.game = game;
+	flushChunk();
+	header.checksum = this->checksum;
+
+	// Every chunk is compressed by now, so the index lands right after them
+	MemoryStream headerStream;
+	writeReplayHeader(header, &headerStream);
+	uint32_t bodyOffset = headerStream.length();
+	header.indexOffset = bodyOffset + this->body.size();
+	headerStream.clear();
+	writeReplayHeader(header, &headerStream);
+
+	MemoryStream index;
+	writeReplayIndex(this->chunks, bodyOffset, this->frameCount, this->namespaces, &index);
+
+	// The replay is finished off next to the old one and only replaces it once it's complete
+	std::string partialPath;
+	bool ownsPartial = false;
+	FILE* file;
+	bool written;
+	if (this->journal != NULL && this->journalBodyOffset == bodyOffset && this->journalMission == mission && this->journalGame == game)
+	{
+		// The journal has every chunk already, it only lacks the index and the real header
+		// The index is on disk before the header points at it, until then the journal still salvages like before
+		file = this->journal;
+		partialPath = this->journalPath;
+		this->journal = NULL;
+		written = fseek(file, header.indexOffset, SEEK_SET) == 0 && writeFile(file, index.getBuffer(), index.length()) && syncFile(file)
+			&& fseek(file, 0, SEEK_SET) == 0 && writeFile(file, headerStream.getBuffer(), headerStream.length());
+	}
+	else
+	{
+		closeJournal(true);
+		partialPath = path + REPLAY_PARTIAL_EXTENSION;
+		ownsPartial = true;
+		file = fopen(partialPath.c_str(), "wb");
+		if (file == NULL)
+			return false;
+		written = writeFile(file, headerStream.getBuffer(), headerStream.length()) && writeFile(file, this->body.data(), this->body.size())
+			&& writeFile(file, index.getBuffer(), index.length());
+	}
+	written = syncFile(file) && written;
+	written = fclose(file) == 0 && written;
+	if (!written)
+	{
+		// A half written replay never gets moved over the old one. The journal is the only copy of the run though, it stays to be salvaged
+		if (ownsPartial)
+			::remove(partialPath.c_str());
+		return false;
+	}
+	return replaceFile(partialPath, path);
+}
+
+bool recoverReplay(std::string partialPath, std::string path)
+{
+	FILE* f = fopen(partialPath.c_str(), "rb");
+	if (f == NULL)
+		return false;
+
+	ReplayHeader header;
+	std::vector<ReplayChunkInfo> chunks;
+	long bodyStart = 0;
+	bool indexed;
+	try
+	{
+		indexed = readReplayHeader(f, &header) && header.version >= REPLAY_VERSION_HEADER && (bodyStart = ftell(f)) >= 0 && readReplayChunkIndex(f, &header, &chunks);
+	}
+	catch (std::runtime_error&)
+	{
+		indexed = false;
+	}
+	if (!indexed)
+	{
+		fclose(f);
+		return false;
+	}
+
+	// Otherwise we crashed between finishing the file and moving it, all that's left to do is the move
+	if (header.indexOffset != 0)
+	{
+		fclose(f);
+		return replaceFile(partialPath, path);
+	}
+
+	// Anything after the last complete chunk is a torn write, the index goes over it
+	long bodyEnd = ftell(f);
+	std::vector<uint8_t> body(bodyEnd - bodyStart);
+	bool read = fseek(f, bodyStart, SEEK_SET) == 0 && (body.empty() || fread(body.data(), 1, body.size(), f) == body.size());
+	fclose(f);
+	if (!read)
+		return false;
+
+	header.indexOffset = bodyEnd;
+	MemoryStream index;
+	writeReplayIndex(chunks, 0, header.frameCount, header.namespaces, &index);
+	MemoryStream headerStream;
+	writeReplayHeader(header, &headerStream);
+
+	// The journal is the only copy of the run, the replay gets finished off in a file of its own and the journal stays until that worked
+	std::string tempPath = partialPath + ".tmp";
+	FILE* file = fopen(tempPath.c_str(), "wb");
+	if (file == NULL)
+		return false;
+	bool written = writeFile(file, headerStream.getBuffer(), headerStream.length()) && writeFile(file, body.data(), body.size())
+		&& writeFile(file, index.getBuffer(), index.length());
+	written = syncFile(file) && written;
+	written = fclose(file) == 0 && written;
+	if (!written || !replaceFile(tempPath, path))
+	{
+		::remove(tempPath.c_str());
+		return false;
+	}
+	::remove(partialPath.c_str());
+	return true;
+}
+
+ReplayReader::ReplayReader()
+{
+	this->file = NULL;
+	this->frameCount = 0;
+	this->totalElapsed = 0;
+	this->lastUsed = 0;
+	this->cache[0].index = -1;
+	this->cache[1].index = -1;
+}
+
+ReplayReader::~ReplayReader()
+{
+	close();
+}
+
+bool ReplayReader::open(std::string path)
+{
+	close();
+	this->file = fopen(path.c_str(), "rb");
+	if (this->file == NULL)
+		return false;
+
+	bool indexed;
+	try
+	{
+		indexed = readReplayHeader(this->file, &this->header) && this->header.version >= REPLAY_VERSION_INDEXED && readReplayChunkIndex(this->file, &this->header, &this->chunks);
+	}
+	catch (std::runtime_error&)
+	{
+		indexed = false;
+	}
+	if (!indexed || this->chunks.size() == 0)
+	{
+		close();
+		return false;
+	}
+
+	this->namespaceIds = internReplayNamespaces(this->header);
+	this->frameCount = this->chunks.back().firstFrame + this->chunks.back().frameCount;
+	if (this->header.version >= REPLAY_VERSION_HEADER || this->header.indexOffset == 0)
+	{
+		this->totalElapsed = this->header.totalElapsed;
+		return true;
+	}
+	// The elapsed time of the last frame is the length of the replay. A broken chunk takes itself and everything after it off the end
+	const FrameStore* last = NULL;
+	while (last == NULL && this->chunks.size() != 0)
+		last = getChunk(this->chunks.size() - 1);
+	if (last == NULL)
+	{
+		close();
+		return false;
+	}
+	this->totalElapsed = last->size() != 0 ? last->getElapsedTime(last->size() - 1) : this->chunks.back().startElapsed;
+	return true;
+}
+
+void ReplayReader::close()
+{
+	if (this->file != NULL)
+		fclose(this->file);
+	this->file = NULL;
+	this->chunks.clear();
+	this->frameCount = 0;
+	this->totalElapsed = 0;
+	this->cache[0].index = -1;
+	this->cache[0].frames.clear();
+	this->cache[1].index = -1;
+	this->cache[1].frames.clear();
+}
+
+const FrameStore* ReplayReader::getChunk(int index)
+{
+	for (int i = 0; i < 2; i++)
+	{
+		if (this->cache[i].index == index)
+		{
+			this->lastUsed = i;
+			return &this->cache[i].frames;
+		}
+	}
+
+	// Evict whichever chunk we didn't touch last
+	int slot = 1 - this->lastUsed;
+	DecodedChunk& decoded = this->cache[slot];
+	decoded.index = -1;
+	decoded.frames.clear();
+
+	const ReplayChunkInfo& info = this->chunks[index];
+	MemoryStream m;
+	fseek(this->file, info.offset, SEEK_SET);
+	bool ok = true;
+	try
+	{
+		int count = readReplayChunk(this->file, this->header.version, &m);
+		ok = count == (int)info.frameCount;
+		if (ok)
+		{
+			int elapsed = info.startElapsed;
+			Frame previous;
+			for (int i = 0; i < count; i++)
+			{
+				Frame frame = readFrame(&m, this->header.version, i == 0 ? NULL : &previous, &this->namespaceIds);
+				if (i != 0)
+					elapsed += frame.deltaMs;
+				frame.elapsedTime = elapsed;
+				decoded.frames.push(frame);
+				previous = frame;
+			}
+		}
+	}
+	catch (std::runtime_error&)
+	{
+		ok = false;
+	}
+
+	if (!ok)
+	{
+		// The replay ends where it's broken, playback stops there instead of indexing into a chunk that isn't there
+		decoded.frames.clear();
+		this->frameCount = info.firstFrame;
+		this->chunks.resize(index);
+		for (int i = 0; i < 2; i++)
+		{
+			if (this->cache[i].index >= index)
+			{
+				this->cache[i].index = -1;
+				this->cache[i].frames.clear();
+			}
+		}
+		return NULL;
+	}
+
+	if (this->resolveBinding)
+		decoded.frames.resolveRewindableBindings(this->resolveBinding);
+
+	decoded.index = index;
+	this->lastUsed = slot;
+	return &decoded.frames;
+}
+
+void ReplayReader::readAll(FrameStore* out, ThreadPool* pool)
+{
+	readReplayChunks(this->file, this->header, this->chunks, pool, [&](int index, std::vector<Frame>& frames)
+	{
+		int elapsed = this->chunks[index].startElapsed;
+		for (size_t i = 0; i < frames.size(); i++)
+		{
+			if (i != 0)
+				elapsed += frames[i].deltaMs;
+			frames[i].elapsedTime = elapsed;
+			out->push(frames[i]);
+		}
+	});
+	if (this->resolveBinding)
+		out->resolveRewindableBindings(this->resolveBinding);
+}
+
+void ReplayReader::setBindingResolver(std::function<int(int)> resolve)
+{
+	this->resolveBinding = resolve;
+	for (int i = 0; i < 2; i++)
+	{
+		if (this->cache[i].index != -1 && this->resolveBinding)
+			this->cache[i].frames.resolveRewindableBindings(this->resolveBinding);
+	}
+}
+
+int ReplayReader::findChunkByFrame(int index)
+{
+	// Playback asks for the chunk it asked for last time most of the time
+	const DecodedChunk& last = this->cache[this->lastUsed];
+	if (last.index != -1 && index >= this->chunks[last.index].firstFrame && index < this->chunks[last.index].firstFrame + (int)this->chunks[last.index].frameCount)
+		return last.index;
+
+	int lo = 0, hi = this->chunks.size() - 1;
+	while (lo < hi)
+	{
+		int m = (lo + hi + 1) / 2;
+		if (this->chunks[m].firstFrame <= index)
+			lo = m;
+		else
+			hi = m - 1;
+	}
+	return lo;
+}
+
+bool ReplayReader::getFrame(int index, Frame* out)
+{
+	if (index < 0 || index >= this->frameCount)
+		return false;
+	int chunk = findChunkByFrame(index);
+	const FrameStore* frames = getChunk(chunk);
+	if (frames == NULL)
+		return false;
+	frames->get(index - this->chunks[chunk].firstFrame, out);
+	return true;
+}
+
+int ReplayReader::getMs(int index)
+{
+	if (index < 0 || index >= this->frameCount)
+		return INT_MAX;
+	int chunk = findChunkByFrame(index);
+	const FrameStore* frames = getChunk(chunk);
+	return frames != NULL ? frames->getMs(index - this->chunks[chunk].firstFrame) : INT_MAX;
+}
+
+int ReplayReader::getElapsedTime(int index)
+{
+	if (index < 0 || index >= this->frameCount)
+		return INT_MAX;
+	int chunk = findChunkByFrame(index);
+	const FrameStore* frames = getChunk(chunk);
+	return frames != NULL ? frames->getElapsedTime(index - this->chunks[chunk].firstFrame) : INT_MAX;
+}
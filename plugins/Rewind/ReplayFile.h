@@ -0,0 +1,254 @@
+#pragma once
+#include <cstdio>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "frame.h"
+#include "FrameStore.h"
+#include "MemoryStream.h"
+#include "MappedFile.h"
+#include "ReplayCodec.h"
+#include "WorkerThread.h"
+
+/*
+*	Replay file layout
+*
+*	Versions 1-12 are a single zlib stream holding every frame, newest first. Those are only read by the legacy path in RewindManager::load.
+*
+*	Version 13 onwards:
+*		char version
+*		uint32 chunk index offset (0 if the replay was never finished, its complete chunks get salvaged when loading)
+*		[15+] uint32 frame count
+*		[15+] int32 ms of the newest frame
+*		[15+] int32 total elapsed time
+*		[15+] uint32 crc32 of the chunk data
+*		string mission
+*		string game
+*		chunks, oldest frames first:
+*			uint32 frame count
+*			uint32 uncompressed size
+*			uint32 compressed size
+*			[18+] uint8 codec, see ReplayCodecId. Zlib before that
+*			[19+] uint32 size of the namespace list that follows
+*			[19+] uint32 namespace count, then that many strings: the namespaces first used by this chunk
+*			compressed frames, see writeFrame
+*		chunk index:
+*			uint32 chunk count
+*			per chunk:
+*				uint32 offset
+*				uint32 frame count
+*				[14+] int32 ms of the first frame
+*				[14+] int32 elapsed time of the first frame
+*			uint32 total frame count
+*			[19+] uint32 namespace count, then that many strings: every namespace of the replay
+*
+*	The version 14 index lets ReplayReader find the chunk holding any timestamp with a binary search, so only that chunk gets uncompressed.
+*	The version 15 header fields let analyzeReplay answer from the header alone.
+*	From version 16 each frame starts with a mask of the fields that changed since the previous frame and only stores those.
+*	The first frame of every chunk is a keyframe with every field set, so chunks still decode on their own.
+*	Version 17 stores moving platform states as raw floats rather than text.
+*	Version 18 lets every chunk pick its own codec.
+*	Version 19 gives every replay its own table of the rewindable namespaces its frames use, rewindable states store a uint16 index into
+*	it instead of the name. Each chunk lists the namespaces it adds to the table, so a journal can keep appending chunks as bindings
+*	get registered and still be salvaged. The index has the whole table, which is what finished replays are read with.
+*/
+
+#define REPLAY_VERSION_CHUNKED 13
+#define REPLAY_VERSION_INDEXED 14
+#define REPLAY_VERSION_HEADER 15
+#define REPLAY_VERSION_DELTA 16
+#define REPLAY_VERSION_BINARY_MPSTATES 17
+#define REPLAY_VERSION_CODECS 18
+#define REPLAY_VERSION_NAMESPACES 19
+#define REPLAY_VERSION REPLAY_VERSION_NAMESPACES
+
+// Replays are written under this suffix and renamed once finished, a crash leaves them behind to be salvaged
+#define REPLAY_PARTIAL_EXTENSION ".partial"
+
+// Frames per chunk, ~1-4 seconds of frames depending on the frame rate
+#define REPLAY_CHUNK_FRAMES 256
+
+struct ReplayChunkInfo
+{
+	uint32_t offset;
+	uint32_t frameCount;
+	int startMs;
+	int startElapsed;
+	int firstFrame; // Not stored, index of the first frame of the chunk in the whole replay
+};
+
+// A chunk as it's stored in the file, read in one go so it can be uncompressed on another thread
+struct ReplayChunkData
+{
+	uint32_t frameCount;
+	uint32_t uncompressedSize;
+	uint8_t codec;
+	std::vector<std::string> namespaces; // [19+] Added to the replay's table by this chunk
+	std::vector<uint8_t> compressed;
+};
+
+struct ReplayHeader
+{
+	char version;
+	uint32_t indexOffset;
+	uint32_t frameCount;
+	int finalTime;
+	int totalElapsed;
+	uint32_t checksum;
+	std::string mission;
+	std::string game;
+	std::vector<std::string> namespaces; // Indexed by the namespace ids stored in the frames, filled in by readReplayChunkIndex
+};
+
+struct ReplayInfo
+{
+	int version;
+	int time;
+	int elapsedTime;
+	int frameCount;
+	std::string replayPath;
+	std::string replayMission;
+	std::string replayGame;
+	uint32_t checksum; // crc32 of the chunk data, 0 before version 15
+};
+
+// previous is the frame written/read right before this one in the same chunk, NULL for keyframes.
+// When writing, namespaceIds maps the namespace ids of this process to the replay's (indexed by internRewindableNamespace id).
+// When reading, it maps the ids read back to the ones of this process (see internReplayNamespaces). Ids are left as they are without it
+void writeFrame(const Frame& frame, MemoryStream* m, const Frame* previous = NULL, const std::vector<int>* namespaceIds = NULL);
+Frame readFrame(MemoryStream* m, char version, const Frame* previous = NULL, const std::vector<int>* namespaceIds = NULL);
+
+// Peeks at the version byte f starts with and leaves f at the start. -1 for an empty file or a version newer than REPLAY_VERSION
+int readReplayVersion(FILE* f);
+
+// Versions 1-12: maps the file and leaves m at the frame count, uncompressing into m's own storage when needed.
+// m may read straight out of the mapping so file has to stay open while it's used. Returns the version or -1
+int openLegacyReplay(std::string path, MappedFile* file, MemoryStream* m);
+
+bool readReplayHeader(FILE* f, ReplayHeader* header);
+// Interns the header's namespaces, the result maps the ids stored in the replay to internRewindableNamespace ids
+std::vector<int> internReplayNamespaces(const ReplayHeader& header);
+// Call right after readReplayHeader. Unfinished replays get every complete chunk salvaged, with the header totals and namespaces
+// filled in from them
+bool readReplayChunkIndex(FILE* f, ReplayHeader* header, std::vector<ReplayChunkInfo>* chunks);
+// Returns the frame count or -1, checksum gets the chunk's bytes added to it if set
+int readReplayChunk(FILE* f, char version, MemoryStream* out, uint32_t* checksum = NULL);
+bool readReplayChunkData(FILE* f, char version, ReplayChunkData* chunk, uint32_t* checksum = NULL);
+// Returns the frame count or -1
+int uncompressReplayChunk(const ReplayChunkData& chunk, MemoryStream* out);
+// Uncompresses and decodes the chunks across pool (or on this thread if it's NULL) and hands every chunk's frames to onChunk,
+// in order and on the calling thread. A chunk that fails to uncompress or decode stops it there and makes it return false
+bool readReplayChunks(FILE* f, const ReplayHeader& header, const std::vector<ReplayChunkInfo>& chunks, ThreadPool* pool, std::function<void(int index, std::vector<Frame>& frames)> onChunk);
+// Fills in whatever can be read out of the replay, false if it couldn't be opened or is corrupt. Doesn't touch TGE so it runs on any thread
+bool analyzeReplayFile(std::string path, ReplayInfo* info);
+// Moves from over to, replacing it in one step so readers only ever see the old or the new file
+bool replaceFile(std::string from, std::string to);
+// Finishes an unfinished replay left behind by a crash in place and moves it to path
+bool recoverReplay(std::string partialPath, std::string path);
+
+/*
+*	Encodes and compresses frames into chunks as they come in and keeps the compressed chunks in memory,
+*	so save only has to write out the header, the chunks and the index.
+*	truncate takes frames back off the end, which is what lets a replay be recorded while the player rewinds.
+*
+*	With a journal open every chunk is also appended to a file as soon as it's compressed, and save finishes that file off
+*	instead of writing a new one. Either way the finished replay only replaces the old one with an atomic rename.
+*/
+class ReplayWriter
+{
+	MemoryStream chunk;
+	std::vector<Frame> chunkFrames; // The frames in chunk, for the delta of the next one and for truncate
+	std::vector<uint32_t> chunkFrameOffsets; // Where each of them starts in chunk
+	std::vector<uint8_t> compressed;
+	std::vector<uint8_t> body; // Every compressed chunk with its header, laid out like in the file
+	std::vector<ReplayChunkInfo> chunks; // Offsets relative to body
+	std::vector<uint32_t> chunkChecksums; // checksum before each chunk
+	std::vector<std::string> namespaces; // The replay's own namespace table, only what its frames use
+	std::vector<int> namespaceIds; // internRewindableNamespace id of every entry in namespaces
+	std::vector<int> localNamespaceIds; // Indexed by internRewindableNamespace id, -1 for namespaces that aren't in the table
+	std::vector<uint32_t> chunkNamespaceStarts; // writtenNamespaces before each chunk
+	uint32_t writtenNamespaces; // Entries of namespaces that chunks already added to the table
+	std::vector<int> skipped; // Indices (counting every writeFrame call) of the frames that were left out
+	int frameCount;
+	int elapsedTime;
+	uint32_t checksum;
+	FILE* journal;
+	std::string journalPath;
+	std::string journalMission;
+	std::string journalGame;
+	uint32_t journalBodyOffset; // Where the chunks start in the journal
+	ReplayCodec codec;
+
+	void addNamespace(int id);
+	template<typename T>
+	void addNamespaces(const std::vector<RewindableState<T>>& states);
+	// Puts the namespaces of frame's rewindable states in the table, before frame gets encoded
+	void addNamespaces(const Frame& frame);
+	void flushChunk();
+	void appendChunk(ReplayChunkInfo info, uint32_t uncompressedSize, uint8_t codec, const uint8_t* data, uint32_t compressedSize);
+	void reopenLastChunk();
+	void dropLastFrames(int count);
+	void closeJournal(bool remove);
+public:
+	ReplayWriter();
+	~ReplayWriter();
+	// Starts appending chunks to path, the journal goes away again on clear or gets finished off by save
+	bool openJournal(std::string path, std::string mission, std::string game);
+	// Applies to chunks compressed from now on, the ones already done keep their codec
+	void setCodec(ReplayCodec codec) { this->codec = codec; }
+	void clear();
+	void writeFrame(const Frame& frame);
+	// Same as calling writeFrame for each of them, but whole chunks get encoded and compressed across pool
+	void writeFrames(const FrameStore& frames, ThreadPool* pool);
+	// Drops every frame from the count-th writeFrame call onwards
+	void truncate(int count);
+	int getFrameCount() { return frameCount; }
+	bool save(std::string path, std::string mission, std::string game);
+};
+
+/*
+*	Random access to a version 14+ replay without uncompressing the whole thing.
+*	The two most recently used chunks are kept decoded so playback and interpolating across a chunk boundary don't thrash.
+*/
+class ReplayReader
+{
+	struct DecodedChunk
+	{
+		int index;
+		FrameStore frames;
+	};
+
+	FILE* file;
+	ReplayHeader header;
+	std::vector<ReplayChunkInfo> chunks;
+	int frameCount;
+	int totalElapsed;
+	DecodedChunk cache[2];
+	int lastUsed;
+	std::vector<int> namespaceIds;
+	std::function<int(int)> resolveBinding;
+
+	// NULL if the chunk can't be read or decoded. The replay gets cut off before it then, so the frame count drops
+	const FrameStore* getChunk(int index);
+	int findChunkByFrame(int index);
+public:
+	ReplayReader();
+	~ReplayReader();
+	bool open(std::string path);
+	void close();
+
+	const ReplayHeader& getHeader() { return header; }
+	int getFrameCount() { return frameCount; }
+	int getTotalElapsed() { return totalElapsed; }
+
+	// False past the end, or if the frame's chunk turned out to be broken. The replay ends before that chunk from then on
+	bool getFrame(int index, Frame* out);
+	// INT_MAX where getFrame would fail, so seeking treats it as past the end
+	int getMs(int index);
+	int getElapsedTime(int index);
+	// Decodes every frame into out, the chunks get uncompressed across pool. Stops at a chunk that doesn't decode
+	void readAll(FrameStore* out, ThreadPool* pool);
+	// Gives every rewindable state the binding index resolve returns for its namespace id, once per decoded chunk
+	void setBindingResolver(std::function<int(int)> resolve);
+};
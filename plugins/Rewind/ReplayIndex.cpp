@@ -0,0 +1,286 @@
+#include "ReplayIndex.h"
+#include <sys/stat.h>
+#include <mutex>
+#include <stdexcept>
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+// index.bin gets read, changed and written back in one go, this keeps two threads from doing so at once
+static std::mutex indexMutex;
+
+static std::string joinPath(const std::string& directory, const std::string& name)
+{
+	if (directory.empty() || directory.back() == '/' || directory.back() == '\\')
+		return directory + name;
+	return directory + "/" + name;
+}
+
+ReplayIndex::ReplayIndex()
+{
+	this->dirty = false;
+}
+
+void ReplayIndex::load(std::string directory)
+{
+	this->directory = directory;
+	this->entries.clear();
+	this->dirty = false;
+
+	FILE* f = fopen(joinPath(directory, REPLAY_INDEX_FILE).c_str(), "rb");
+	if (f == NULL)
+		return;
+	std::vector<uint8_t> data;
+	uint8_t buffer[16384];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), f)) != 0)
+		data.insert(data.end(), buffer, buffer + read);
+	fclose(f);
+
+	MemoryStream m;
+	m.borrowBuffer(data.data(), data.size());
+	try
+	{
+		if (data.empty() || m.readChar() != REPLAY_INDEX_VERSION)
+			return;
+		uint32_t count = m.readUInt32();
+		for (uint32_t i = 0; i < count; i++)
+		{
+			ReplayIndexEntry entry;
+			entry.name = m.readString();
+			entry.size = m.readUInt64();
+			entry.mtime = m.readInt64();
+			entry.valid = m.readBool();
+			entry.info.replayPath = joinPath(directory, entry.name);
+			entry.info.version = m.readInt32();
+			entry.info.replayMission = m.readString();
+			entry.info.replayGame = m.readString();
+			entry.info.frameCount = m.readInt32();
+			entry.info.time = m.readInt32();
+			entry.info.elapsedTime = m.readInt32();
+			entry.info.checksum = m.readUInt32();
+			this->entries[entry.name] = entry;
+		}
+	}
+	catch (std::runtime_error&)
+	{
+		// Cut off, whatever was read completely is still good
+	}
+}
+
+bool ReplayIndex::save()
+{
+	if (!this->dirty)
+		return true;
+
+	MemoryStream m;
+	m.writeChar(REPLAY_INDEX_VERSION);
+	m.writeUInt32(this->entries.size());
+	for (auto& it : this->entries)
+	{
+		const ReplayIndexEntry& entry = it.second;
+		m.writeString(entry.name);
+		m.writeUInt64(entry.size);
+		m.writeInt64(entry.mtime);
+		m.writeBool(entry.valid);
+		m.writeInt32(entry.info.version);
+		m.writeString(entry.info.replayMission);
+		m.writeString(entry.info.replayGame);
+		m.writeInt32(entry.info.frameCount);
+		m.writeInt32(entry.info.time);
+		m.writeInt32(entry.info.elapsedTime);
+		m.writeUInt32(entry.info.checksum);
+	}
+
+	std::string path = joinPath(this->directory, REPLAY_INDEX_FILE);
+	std::string partialPath = path + REPLAY_PARTIAL_EXTENSION;
+	FILE* f = fopen(partialPath.c_str(), "wb");
+	if (f == NULL)
+		return false;
+	bool written = fwrite(m.getBuffer(), 1, m.length(), f) == m.length();
+	fclose(f);
+	if (!written || !replaceFile(partialPath, path))
+	{
+		remove(partialPath.c_str());
+		return false;
+	}
+	this->dirty = false;
+	return true;
+}
+
+const ReplayIndexEntry* ReplayIndex::find(const std::string& name, uint64_t size, int64_t mtime) const
+{
+	auto it = this->entries.find(name);
+	if (it == this->entries.end() || it->second.size != size || it->second.mtime != mtime)
+		return NULL;
+	return &it->second;
+}
+
+void ReplayIndex::update(const ReplayIndexEntry& entry)
+{
+	this->entries[entry.name] = entry;
+	this->dirty = true;
+}
+
+void ReplayIndex::remove(const std::string& name)
+{
+	if (this->entries.erase(name) != 0)
+		this->dirty = true;
+}
+
+void ReplayIndex::retain(const std::vector<std::string>& names)
+{
+	std::map<std::string, ReplayIndexEntry> kept;
+	for (auto& name : names)
+	{
+		auto it = this->entries.find(name);
+		if (it != this->entries.end())
+			kept[name] = it->second;
+	}
+	if (kept.size() != this->entries.size())
+		this->dirty = true;
+	this->entries.swap(kept);
+}
+
+bool getReplayFileStat(std::string path, uint64_t* size, int64_t* mtime)
+{
+	struct stat b;
+	if (stat(path.c_str(), &b) != 0)
+		return false;
+	*size = b.st_size;
+	*mtime = b.st_mtime;
+	return true;
+}
+
+static bool isReplayFile(const std::string& name)
+{
+	return name.size() > 4 && name.compare(name.size() - 4, 4, ".rwx") == 0;
+}
+
+std::vector<std::string> listReplayFiles(std::string directory)
+{
+	std::vector<std::string> names;
+#ifdef WIN32
+	WIN32_FIND_DATAA data;
+	HANDLE find = FindFirstFileA(joinPath(directory, "*.rwx").c_str(), &data);
+	if (find == INVALID_HANDLE_VALUE)
+		return names;
+	do
+	{
+		if (!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && isReplayFile(data.cFileName))
+			names.push_back(data.cFileName);
+	} while (FindNextFileA(find, &data));
+	FindClose(find);
+#else
+	DIR* dir = opendir(directory.c_str());
+	if (dir == NULL)
+		return names;
+	struct dirent* entry;
+	while ((entry = readdir(dir)) != NULL)
+	{
+		if (isReplayFile(entry->d_name))
+			names.push_back(entry->d_name);
+	}
+	closedir(dir);
+#endif
+	return names;
+}
+
+static std::vector<ReplayIndexEntry> getSortedEntries(const ReplayIndex& index)
+{
+	std::vector<ReplayIndexEntry> entries;
+	for (auto& it : index.getEntries())
+		entries.push_back(it.second);
+	return entries;
+}
+
+std::vector<ReplayIndexEntry> readReplayIndex(std::string directory)
+{
+	std::lock_guard<std::mutex> lock(indexMutex);
+	ReplayIndex index;
+	index.load(directory);
+	return getSortedEntries(index);
+}
+
+void updateReplayIndex(std::string path, const ReplayInfo* info)
+{
+	size_t slash = path.find_last_of("/\\");
+	std::string directory = slash == std::string::npos ? std::string() : path.substr(0, slash);
+	ReplayIndexEntry entry;
+	entry.name = slash == std::string::npos ? path : path.substr(slash + 1);
+	bool exists = getReplayFileStat(path, &entry.size, &entry.mtime);
+	if (exists)
+	{
+		if (info != NULL)
+		{
+			entry.info = *info;
+			entry.valid = true;
+		}
+		else
+		{
+			try
+			{
+				entry.valid = analyzeReplayFile(path, &entry.info);
+			}
+			catch (std::runtime_error&)
+			{
+				entry.valid = false;
+			}
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(indexMutex);
+	ReplayIndex index;
+	index.load(directory);
+	if (exists)
+		index.update(entry);
+	else
+		index.remove(entry.name);
+	index.save();
+}
+
+std::vector<ReplayIndexEntry> scanReplayDirectory(std::string directory, ThreadPool* pool)
+{
+	std::lock_guard<std::mutex> lock(indexMutex);
+	ReplayIndex index;
+	index.load(directory);
+
+	std::vector<std::string> names = listReplayFiles(directory);
+	std::vector<ReplayIndexEntry> stale;
+	for (auto& name : names)
+	{
+		ReplayIndexEntry entry;
+		entry.name = name;
+		if (!getReplayFileStat(joinPath(directory, name), &entry.size, &entry.mtime))
+			continue;
+		if (index.find(name, entry.size, entry.mtime) == NULL)
+			stale.push_back(entry);
+	}
+
+	// Only the replays that are new or changed since the last scan get opened
+	auto analyze = [&](int i)
+	{
+		ReplayIndexEntry& entry = stale[i];
+		try
+		{
+			entry.valid = analyzeReplayFile(joinPath(directory, entry.name), &entry.info);
+		}
+		catch (std::runtime_error&)
+		{
+			entry.valid = false;
+		}
+	};
+	if (pool != NULL)
+		pool->parallelFor(stale.size(), analyze);
+	else
+		for (size_t i = 0; i < stale.size(); i++)
+			analyze(i);
+
+	for (auto& entry : stale)
+		index.update(entry);
+	index.retain(names);
+	index.save();
+	return getSortedEntries(index);
+}
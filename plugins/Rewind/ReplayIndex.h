@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "ReplayFile.h"
+#include "WorkerThread.h"
+
+#define REPLAY_INDEX_FILE "index.bin"
+#define REPLAY_INDEX_VERSION 1
+
+struct ReplayIndexEntry
+{
+	std::string name; // File name inside the directory
+	uint64_t size;
+	int64_t mtime;
+	bool valid; // False if the replay couldn't be analyzed
+	ReplayInfo info;
+};
+
+/*
+*	ReplayInfo for every replay in a directory, cached in index.bin next to them.
+*	Entries remember the size and modification time of the file they were made from,
+*	so a replay only gets analyzed again once it changes.
+*
+*	Saving or analyzing a replay updates its entry right away, so the replay list can come straight out of the index
+*	without looking at the replays themselves. Every function below can be called from any thread.
+*/
+class ReplayIndex
+{
+	std::string directory;
+	std::map<std::string, ReplayIndexEntry> entries;
+	bool dirty;
+
+public:
+	ReplayIndex();
+	// A missing or unreadable index just starts out empty
+	void load(std::string directory);
+	// Only writes anything if an entry changed
+	bool save();
+
+	// NULL unless there's an entry for name made from a file of this size and mtime
+	const ReplayIndexEntry* find(const std::string& name, uint64_t size, int64_t mtime) const;
+	void update(const ReplayIndexEntry& entry);
+	void remove(const std::string& name);
+	// Drops the entries of files that aren't in names anymore
+	void retain(const std::vector<std::string>& names);
+	const std::map<std::string, ReplayIndexEntry>& getEntries() const { return entries; }
+};
+
+bool getReplayFileStat(std::string path, uint64_t* size, int64_t* mtime);
+// Names of the .rwx files in directory
+std::vector<std::string> listReplayFiles(std::string directory);
+// Every entry in the index of directory, sorted by name, without checking them against the files
+std::vector<ReplayIndexEntry> readReplayIndex(std::string directory);
+// Updates the entry of the replay at path in the index of its directory, or drops it if the file is gone.
+// The replay gets analyzed unless info (from a successful analysis) is set
+void updateReplayIndex(std::string path, const ReplayInfo* info = NULL);
+// Brings the index of directory up to date, new and changed replays get analyzed across pool. Returns every entry, sorted by name
+std::vector<ReplayIndexEntry> scanReplayDirectory(std::string directory, ThreadPool* pool);
@@ -0,0 +1,124 @@
+#include "ReplayRecorder.h"
+
+ReplayRecorder::ReplayRecorder()
+{
+	this->stopping = false;
+	this->thread = std::thread(&ReplayRecorder::run, this);
+}
+
+ReplayRecorder::~ReplayRecorder()
+{
+	this->mutex.lock();
+	this->stopping = true;
+	this->mutex.unlock();
+	this->wake.notify_one();
+	this->thread.join();
+}
+
+void ReplayRecorder::queue(Task& task)
+{
+	this->mutex.lock();
+	this->tasks.push_back(std::move(task));
+	this->mutex.unlock();
+	this->wake.notify_one();
+}
+
+void ReplayRecorder::openJournal(std::string path, std::string mission, std::string game)
+{
+	Task task;
+	task.type = OpenJournal;
+	task.path = path;
+	task.mission = mission;
+	task.game = game;
+	queue(task);
+}
+
+void ReplayRecorder::setCodec(ReplayCodec codec)
+{
+	Task task;
+	task.type = SetCodec;
+	task.codec = codec;
+	queue(task);
+}
+
+void ReplayRecorder::append(Frame frame)
+{
+	Task task;
+	task.type = AppendFrame;
+	task.frame = std::move(frame);
+	queue(task);
+}
+
+void ReplayRecorder::truncate(int count)
+{
+	Task task;
+	task.type = TruncateFrames;
+	task.count = count;
+	queue(task);
+}
+
+void ReplayRecorder::save(std::string path, std::string mission, std::string game, std::function<void(bool)> onSaved)
+{
+	Task task;
+	task.type = SaveReplay;
+	task.path = path;
+	task.mission = mission;
+	task.game = game;
+	task.onSaved = onSaved;
+	queue(task);
+}
+
+void ReplayRecorder::clear()
+{
+	Task task;
+	task.type = ClearReplay;
+	queue(task);
+}
+
+void ReplayRecorder::run()
+{
+	while (true)
+	{
+		std::unique_lock<std::mutex> lock(this->mutex);
+		this->wake.wait(lock, [this]() { return this->stopping || !this->tasks.empty(); });
+		if (this->tasks.empty())
+			return;
+		Task task = std::move(this->tasks.front());
+		this->tasks.pop_front();
+		lock.unlock();
+
+		switch (task.type)
+		{
+		case OpenJournal:
+			this->writer.openJournal(task.path, task.mission, task.game);
+			break;
+
+		case SetCodec:
+			this->writer.setCodec(task.codec);
+			break;
+
+		case AppendFrame:
+			this->writer.writeFrame(task.frame);
+			break;
+
+		case TruncateFrames:
+			this->writer.truncate(task.count);
+			break;
+
+		case SaveReplay:
+		{
+			bool saved = true;
+			if (this->writer.getFrameCount() != 0) //We dun wanna save empty files
+				saved = this->writer.save(task.path, task.mission, task.game);
+			this->writer.clear();
+			if (task.onSaved)
+				task.onSaved(saved);
+			break;
+		}
+
+		case ClearReplay:
+			this->writer.clear();
+			break;
+		}
+	}
+}
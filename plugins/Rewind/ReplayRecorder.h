@@ -0,0 +1,68 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "frame.h"
+#include "ReplayFile.h"
+
+/*
+*	Records the run being played on a thread of its own.
+*	Frames get encoded and compressed by a ReplayWriter while the game keeps running, so finishing a run only has to write out
+*	what's already compressed, and the main thread never has to copy the whole history to get it saved.
+*
+*	Frames are counted in the order they were appended, truncate takes back the ones the player rewound over.
+*	Chunks also go into a journal as they're compressed, so a crash mid run still leaves a replay behind.
+*/
+class ReplayRecorder
+{
+	enum TaskType
+	{
+		OpenJournal,
+		SetCodec,
+		AppendFrame,
+		TruncateFrames,
+		SaveReplay,
+		ClearReplay
+	};
+
+	struct Task
+	{
+		TaskType type;
+		Frame frame;
+		int count;
+		std::string path;
+		std::string mission;
+		std::string game;
+		std::function<void(bool)> onSaved;
+		ReplayCodec codec;
+	};
+
+	ReplayWriter writer;
+	std::deque<Task> tasks;
+	std::mutex mutex;
+	std::condition_variable wake;
+	bool stopping;
+	std::thread thread;
+
+	void queue(Task& task);
+	void run();
+
+public:
+	ReplayRecorder();
+	// Finishes whatever is still queued first, so a replay saved right before shutting down still makes it to disk
+	~ReplayRecorder();
+
+	// Compressed chunks get appended to path until the replay is saved or cleared
+	void openJournal(std::string path, std::string mission, std::string game);
+	// Chunks compressed after this use codec
+	void setCodec(ReplayCodec codec);
+	void append(Frame frame);
+	void truncate(int count);
+	// Writes out every frame appended so far and starts over. onSaved runs on the recorder thread once it's done,
+	// with false if the file couldn't be written. Nothing gets written if no frames were appended
+	void save(std::string path, std::string mission, std::string game, std::function<void(bool)> onSaved);
+	void clear();
+};
@@ -311,7 +311,8 @@ void GetMissionState(TGE::SimGroup* group, MissionState* missionstate)
 						// Very hacky cause apparently the macros dont work on Mac build
 #ifdef WIN32
 #define StoreRewindableState(type1,type2) 	RewindableBinding<##type1##>* rewindable = static_cast<RewindableBinding<##type1##>*>(binding); \
-						RewindableState<##type1##> state(binding->BindingNamespace); \
+						RewindableState<##type1##> state(binding->NamespaceId); \
+						state.bindingIndex = i; \
 						state.value = rewindable->getState(obj); \
 						missionstate->rewindable##type2##States.push_back(state);
 						if (storagetype == 0)
@@ -337,28 +338,32 @@ void GetMissionState(TGE::SimGroup* group, MissionState* missionstate)
 						if (storagetype == 0)
 						{
 							RewindableBinding<int>* rewindable = static_cast<RewindableBinding<int>*>(binding);
-							RewindableState<int> state(binding->BindingNamespace);
+							RewindableState<int> state(binding->NamespaceId);
+							state.bindingIndex = i;
 							state.value = rewindable->getState(obj);
 							missionstate->rewindableIntStates.push_back(state);
 						}
 						if (storagetype == 1)
 						{
 							RewindableBinding<float>* rewindable = static_cast<RewindableBinding<float>*>(binding);
-							RewindableState<float> state(binding->BindingNamespace);
+							RewindableState<float> state(binding->NamespaceId);
+							state.bindingIndex = i;
 							state.value = rewindable->getState(obj);
 							missionstate->rewindableFloatStates.push_back(state);
 						}
 						if (storagetype == 2)
 						{
 							RewindableBinding<bool>* rewindable = static_cast<RewindableBinding<bool>*>(binding);
-							RewindableState<bool> state(binding->BindingNamespace);
+							RewindableState<bool> state(binding->NamespaceId);
+							state.bindingIndex = i;
 							state.value = rewindable->getState(obj);
 							missionstate->rewindableBoolStates.push_back(state);
 						}
 						if (storagetype == 3)
 						{
 							RewindableBinding<std::string>* rewindable = static_cast<RewindableBinding<std::string>*>(binding);
-							RewindableState<std::string> state(binding->BindingNamespace);
+							RewindableState<std::string> state(binding->NamespaceId);
+							state.bindingIndex = i;
 							state.value = rewindable->getState(obj);
 							missionstate->rewindableStringStates.push_back(state);
 						}
@@ -788,7 +793,8 @@ Frame GetCurrentFrame(int ms)
 		DebugPrint("Getting RewindableState %s::%d", binding->BindingNamespace.c_str(), binding->getStorageType());
 
 #ifdef WIN32
-#define StoreRSState(type1,type2)  RewindableState<##type1##> rs(binding->BindingNamespace); \
+#define StoreRSState(type1,type2)  RewindableState<##type1##> rs(binding->NamespaceId); \
+		rs.bindingIndex = i; \
 		rs.value = static_cast<RewindableBinding<##type1##>*>(binding)->getState(); \
 		f.rewindable##type2##States.push_back(rs);
 
@@ -815,25 +821,29 @@ Frame GetCurrentFrame(int ms)
 #ifdef __APPLE__
 		if (type == 0)
 		{
-			RewindableState<int> rs(binding->BindingNamespace);
+			RewindableState<int> rs(binding->NamespaceId);
+			rs.bindingIndex = i;
 			rs.value = static_cast<RewindableBinding<int>*>(binding)->getState();
 			f.rewindableIntStates.push_back(rs);
 		}
 		else if (type == 1)
 		{
-			RewindableState<float> rs(binding->BindingNamespace);
+			RewindableState<float> rs(binding->NamespaceId);
+			rs.bindingIndex = i;
 			rs.value = static_cast<RewindableBinding<float>*>(binding)->getState();
 			f.rewindableFloatStates.push_back(rs);
 		}
 		else if (type == 2)
 		{
-			RewindableState<bool> rs(binding->BindingNamespace);
+			RewindableState<bool> rs(binding->NamespaceId);
+			rs.bindingIndex = i;
 			rs.value = static_cast<RewindableBinding<bool>*>(binding)->getState();
 			f.rewindableBoolStates.push_back(rs);
 		}
 		else if (type == 3)
 		{
-			RewindableState<std::string> rs(binding->BindingNamespace);
+			RewindableState<std::string> rs(binding->NamespaceId);
+			rs.bindingIndex = i;
 			rs.value = static_cast<RewindableBinding<std::string>*>(binding)->getState();
 			f.rewindableStringStates.push_back(rs);
 		}
@@ -896,13 +906,17 @@ void RewindFrame(Frame* f)
 	float rewindDelta = atoi(getField(TGE::Sim::findObject("PlayGui"),"timeDelta"));
 
 	Frame* framedata = NULL;
+	bool ownsFrame = false; // f belongs to the caller, only frames taken from rewindManager here get deleted
 
 	DebugPrint("Obtaining Frame to rewind to");
 	if (rewindManager.getFrameCount() <= 1)
 	{
 		DebugPrint("One or no frames left");
 		if (rewindManager.getFrameCount() != 0)
+		{
 			framedata = new Frame(rewindManager.popFrame(false));
+			ownsFrame = true;
+		}
 		else
 			framedata = NULL;
 	}
@@ -913,16 +927,19 @@ void RewindFrame(Frame* f)
 		{
 			rewindDelta *= atof(TGE::Con::getVariable("$pref::Rewind::TimeScale"));
 			DebugPrint("Altered Delta %c", rewindDelta);
-			framedata = rewindManager.getNextRewindFrame(rewindDelta);
-
-			if (framedata == NULL)
+			if (rewindManager.getNextRewindFrame(rewindDelta, &rewindScratchFrame))
+				framedata = &rewindScratchFrame;
+			else
 				framedata = &previousFrame;
 		}
 		else
 		{
 			DebugPrint("Unaltered Delta");
 			if (f == NULL)
+			{
 				framedata = new Frame(rewindManager.popFrame(false));
+				ownsFrame = true;
+			}
 			else
 				framedata = f;
 
@@ -1112,7 +1129,7 @@ void RewindFrame(Frame* f)
 
 	DebugPrint("Setting Powerup %d", framedata->powerup);
 	TGE::Con::executef(player, 2, "setPowerup", TGE::StringTable->insert(StringMath::print(framedata->powerup), true));
-	if (framedata != &previousFrame)
+	if (ownsFrame)
 		deleteSafe(framedata);
 	DebugPop("Leaving RewindFrame");
 }
@@ -15,6 +15,7 @@ extern std::map<int, TGE::ShapeBase*> serverToClientSBMap;
 
 extern Frame previousGhostFrame;
 extern Frame previousFrame;
+extern Frame rewindScratchFrame;
 
 extern bool physicsOn;
 
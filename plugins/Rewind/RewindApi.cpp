@@ -1,13 +1,17 @@
 #include <TorqueLib/TGE.h>
+#include <TorqueLib/math/mMath.h>
 #include "RewindApi.h"
 #include <cstdio>
 #include "StringMath.h"
 #include <string>
+#include <mutex>
+#include <unordered_map>
 
 template <typename T>
 RewindableBinding<T>::RewindableBinding(RewindableType bindingtype,std::string bindingnamespace)
 {
 	this->BindingNamespace = bindingnamespace;
+	this->NamespaceId = internRewindableNamespace(bindingnamespace);
 	this->BindingType = bindingtype;
 }
 
@@ -15,6 +19,7 @@ template<>
 RewindableBinding<int>::RewindableBinding(RewindableType bindingtype, std::string bindingnamespace)
 {
 	this->BindingNamespace = bindingnamespace;
+	this->NamespaceId = internRewindableNamespace(bindingnamespace);
 	this->BindingType = bindingtype;
 }
 
@@ -22,6 +27,7 @@ template<>
 RewindableBinding<float>::RewindableBinding(RewindableType bindingtype, std::string bindingnamespace)
 {
 	this->BindingNamespace = bindingnamespace;
+	this->NamespaceId = internRewindableNamespace(bindingnamespace);
 	this->BindingType = bindingtype;
 }
 
@@ -29,6 +35,7 @@ template<>
 RewindableBinding<bool>::RewindableBinding(RewindableType bindingtype, std::string bindingnamespace)
 {
 	this->BindingNamespace = bindingnamespace;
+	this->NamespaceId = internRewindableNamespace(bindingnamespace);
 	this->BindingType = bindingtype;
 }
 
@@ -36,10 +43,43 @@ template<>
 RewindableBinding<std::string>::RewindableBinding(RewindableType bindingtype, std::string bindingnamespace)
 {
 	this->BindingNamespace = bindingnamespace;
+	this->NamespaceId = internRewindableNamespace(bindingnamespace);
 	this->BindingType = bindingtype;
 }
 
 
+// Namespace interning
+static std::mutex namespaceMutex;
+static std::vector<std::string> namespaceNames;
+static std::unordered_map<std::string, int> namespaceIds;
+
+int internRewindableNamespace(const std::string& bindingnamespace)
+{
+	std::lock_guard<std::mutex> lock(namespaceMutex);
+	auto it = namespaceIds.find(bindingnamespace);
+	if (it != namespaceIds.end())
+		return it->second;
+	int id = namespaceNames.size();
+	namespaceNames.push_back(bindingnamespace);
+	namespaceIds.insert(std::make_pair(bindingnamespace, id));
+	return id;
+}
+
+std::string getRewindableNamespace(int id)
+{
+	std::lock_guard<std::mutex> lock(namespaceMutex);
+	if (id < 0 || (size_t)id >= namespaceNames.size())
+		return std::string();
+	return namespaceNames[id];
+}
+
+RewindableBindingBase::RewindableBindingBase()
+{
+	this->NamespaceId = -1;
+	this->Native = false;
+	this->InterpMode = InterpLinear;
+}
+
 // Get Storage Type
 int RewindableBindingBase::getStorageType()
 {
@@ -139,24 +179,32 @@ const char* executefnmspc(const char* ns, const char* fn, S32 argc, ...)
 template<>
 int RewindableBinding<int>::getState()
 {
+	if (Native)
+		return TGE::Con::getIntVariable(BindingNamespace.c_str());
 	return torqueAtoi(executefnmspc(BindingNamespace.c_str(), "getState", 0));
 }
 
 template<>
 float RewindableBinding<float>::getState()
 {
+	if (Native)
+		return TGE::Con::getFloatVariable(BindingNamespace.c_str());
 	return torqueAtof(executefnmspc(BindingNamespace.c_str(), "getState", 0));
 }
 
 template<>
 bool RewindableBinding<bool>::getState()
 {
+	if (Native)
+		return TGE::Con::getBoolVariable(BindingNamespace.c_str());
 	return torqueAtoi(executefnmspc(BindingNamespace.c_str(), "getState", 0));
 }
 
 template<>
 std::string RewindableBinding<std::string>::getState()
 {
+	if (Native)
+		return std::string(TGE::Con::getVariable(BindingNamespace.c_str()));
 	return std::string(executefnmspc(BindingNamespace.c_str(), "getState", 0));
 }
 
@@ -192,10 +240,41 @@ void RewindableBinding<T>::setState(T state)
 	executefnmspc(BindingNamespace.c_str(), "setState", 1, TGE::StringTable->insert(StringMath::print(state), false));
 }
 
+template<>
+void RewindableBinding<int>::setState(int state)
+{
+	if (Native)
+		TGE::Con::setIntVariable(BindingNamespace.c_str(), state);
+	else
+		executefnmspc(BindingNamespace.c_str(), "setState", 1, TGE::StringTable->insert(StringMath::print(state), false));
+}
+
+template<>
+void RewindableBinding<float>::setState(float state)
+{
+	if (Native)
+		TGE::Con::setFloatVariable(BindingNamespace.c_str(), state);
+	else
+		executefnmspc(BindingNamespace.c_str(), "setState", 1, TGE::StringTable->insert(StringMath::print(state), false));
+}
+
+template<>
+void RewindableBinding<bool>::setState(bool state)
+{
+	if (Native)
+		TGE::Con::setBoolVariable(BindingNamespace.c_str(), state);
+	else
+		executefnmspc(BindingNamespace.c_str(), "setState", 1, TGE::StringTable->insert(StringMath::print(state), false));
+}
 
 template<>
 void RewindableBinding<std::string>::setState(std::string state)
 {
+	if (Native)
+	{
+		TGE::Con::setVariable(BindingNamespace.c_str(), state.c_str());
+		return;
+	}
 	executefnmspc(BindingNamespace.c_str(), "setState", 1, state.c_str());
 }
 
@@ -217,6 +296,8 @@ void RewindableBinding<std::string>::setState(std::string state, TGE::SimObject*
 template<>
 int RewindableBinding<int>::interpolateState(int one, int two, float ratio, float delta)
 {
+	if (Native)
+		return (InterpMode == InterpStep) ? ((ratio > 0.5) ? two : one) : (int)mLerp(one, two, ratio);
 	std::string oneptr = std::to_string(one);
 	std::string twoptr = std::to_string(two);
 	std::string ratioptr = std::to_string(ratio);
@@ -227,6 +308,22 @@ int RewindableBinding<int>::interpolateState(int one, int two, float ratio, floa
 template<>
 float RewindableBinding<float>::interpolateState(float one, float two, float ratio, float delta)
 {
+	if (Native)
+	{
+		if (InterpMode == InterpStep)
+			return (ratio > 0.5) ? two : one;
+		if (InterpMode == InterpAngleWrap)
+		{
+			// Go the short way round so 350 -> 10 degrees doesn't sweep back through 180
+			float diff = fmodf(two - one, M_2PI_F);
+			if (diff > M_PI_F)
+				diff -= M_2PI_F;
+			else if (diff < -M_PI_F)
+				diff += M_2PI_F;
+			return one + diff * ratio;
+		}
+		return mLerp(one, two, ratio);
+	}
 	std::string oneptr = std::to_string(one);
 	std::string twoptr = std::to_string(two);
 	std::string ratioptr = std::to_string(ratio);
@@ -237,6 +334,8 @@ float RewindableBinding<float>::interpolateState(float one, float two, float rat
 template<>
 bool RewindableBinding<bool>::interpolateState(bool one, bool two, float ratio, float delta)
 {
+	if (Native)
+		return (ratio > 0.5) ? two : one;
 	std::string oneptr = std::to_string(one);
 	std::string twoptr = std::to_string(two);
 	std::string ratioptr = std::to_string(ratio);
@@ -247,6 +346,8 @@ bool RewindableBinding<bool>::interpolateState(bool one, bool two, float ratio,
 template<>
 std::string RewindableBinding<std::string>::interpolateState(std::string one, std::string two, float ratio, float delta)
 {
+	if (Native)
+		return (ratio > 0.5) ? two : one;
 	const char* oneptr = one.c_str();
 	const char* twoptr = two.c_str();
 	std::string ratioptr = std::to_string(ratio);
@@ -257,6 +358,8 @@ std::string RewindableBinding<std::string>::interpolateState(std::string one, st
 // OnRewind (Variable)
 void RewindableBindingBase::onRewind()
 {
+	if (Native)
+		return; // There's no namespace to call into
 	executefnmspc(BindingNamespace.c_str(), "onRewind", 0);
 }
 
@@ -269,9 +372,9 @@ void RewindableBindingBase::onRewind(TGE::SimObject* obj)
 
 // RewindableState IO
 template <typename T>
-RewindableState<T> RewindableState<T>::read(MemoryStream* f)
+RewindableState<T> RewindableState<T>::read(MemoryStream* f, bool interned)
 {
-	RewindableState<T> state(f->readString());
+	RewindableState<T> state(interned ? f->readUInt16() : internRewindableNamespace(f->readString()));
 
 	state.value = f->read<T>();
 
@@ -279,16 +382,17 @@ RewindableState<T> RewindableState<T>::read(MemoryStream* f)
 }
 
 template <typename T>
-void RewindableState<T>::write(MemoryStream* f)
+void RewindableState<T>::write(MemoryStream* f, int namespaceId) const
 {
-	f->writeString(this->bindingnamespace);
+	f->writeUInt16(namespaceId);
 	f->write<T>(this->value);
 }
 
 template <typename T>
-RewindableState<T>::RewindableState(std::string bindingnamespace)
+RewindableState<T>::RewindableState(int namespaceId)
 {
-	this->bindingnamespace = bindingnamespace;
+	this->namespaceId = namespaceId;
+	this->bindingIndex = -1;
 }
 
 template class RewindableState<int>;
@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <vector>
 #include <TorqueLib/TGE.h>
 #include "MemoryStream.h"
 
@@ -7,6 +8,7 @@
 Rewind API Docs:
 
 	registerBinding(namespace,type,storagetype)
+	registerRewindableVariable(variable,storagetype,interpMode)
 	unregisterBinding(namespace)
 
 
@@ -24,25 +26,51 @@ Callbacks:
 		namespace::onRewind(%obj)
 
 
+	Native Variable Binding:
+		No callbacks, the console variable is read and written directly and interpolated with interpMode
+
+
 BindingType
 	Variable: normal getState, setState
 	SceneObject: goes in MissionState
 
+InterpMode (native bindings only)
+	InterpLinear: lerp, ints get truncated
+	InterpStep: takes whichever state is closer, always used for bools and strings
+	InterpAngleWrap: lerps floats in radians along the shortest way round, linear for ints
+
 */
 
 const char* executefnmspc(const char* ns, const char* fn, S32 argc, ...);
 
+// Every namespace gets a small id that stays the same until the game closes, rewindable states carry the id instead of the name.
+// Ids are never freed so they can be handed around between threads, all of these are safe to call from any thread
+int internRewindableNamespace(const std::string& bindingnamespace);
+std::string getRewindableNamespace(int id);
+
 enum RewindableType
 {
 	SceneObject = 0,
 	Variable = 1
 };
 
+enum RewindableInterpMode
+{
+	InterpLinear = 0,
+	InterpStep = 1,
+	InterpAngleWrap = 2
+};
+
 class RewindableBindingBase
 {
 public:
 	RewindableType BindingType;
 	std::string BindingNamespace;
+	int NamespaceId; // Interned BindingNamespace
+	// Native bindings are plain console variables, BindingNamespace is the variable name and nothing goes through script
+	bool Native;
+	RewindableInterpMode InterpMode;
+	RewindableBindingBase();
 	virtual int getStorageType();
 	void onRewind();
 	void onRewind(TGE::SimObject* obj);
@@ -67,11 +95,16 @@ template <typename T>
 struct RewindableState
 {
 	T value;
-	std::string bindingnamespace;
+	int namespaceId; // See internRewindableNamespace
+	// Index of the binding in RewindManager::rewindableBindings, set when the state is captured and resolved again whenever the frames
+	// get loaded or the bindings change. Not stored in replays. -1 if there's no such binding
+	int bindingIndex;
 public:
-	RewindableState(std::string bindingnamespace);
-	static RewindableState read(MemoryStream* f);
-	void write(MemoryStream* f);
+	RewindableState(int namespaceId);
+	// interned: the namespace is stored as a uint16 id rather than its name, the id is read as is
+	static RewindableState read(MemoryStream* f, bool interned);
+	// namespaceId is what the replay being written calls this state's namespace
+	void write(MemoryStream* f, int namespaceId) const;
 
 
 };
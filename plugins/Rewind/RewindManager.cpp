@@ -4,185 +4,27 @@
 #include <zlib.h>
 #include "StringMath.h"
 #include <map>
+#include <algorithm>
+#include <unordered_set>
 #include <thread>
+#include <stdexcept>
 #include "MemoryStream.h"
 #include "Logging.h"
 #include "Dispatcher.h"
+#include "ReplayFile.h"
+#include "ReplayRecorder.h"
+#include "ReplayIndex.h"
+#include "LerpSpan.h"
 
 extern Dispatcher dispatcher;
 
-std::vector<std::string> SplitStringDelim(std::string str, char delim);
-
-void write_list_mpstates(std::vector<MPState> list, MemoryStream* f)
-{
-	std::string exportstr = std::string("[");
-	for (int i = 0; i < list.size(); i++)
-	{
-		char buf[64];
-		sprintf(buf, "%f,%f", list[i].pathPosition, list[i].targetPosition);
-		exportstr += std::string(buf);
-		if (i != list.size() - 1)
-			exportstr += std::string(";");
-	}
-	exportstr += std::string("]");
-
-	f->writeString(exportstr);;
-}
-
-template<typename T>
-void write_vector(std::vector<T> list, MemoryStream* f)
-{
-	int c = list.size();
-	f->writeInt32(c);
-
-	for (int i = 0; i < list.size(); i++)
-	{
-		f->write<T>(list[i]);
-	}
-}
-
-template<typename T>
-std::vector<T> read_vector(MemoryStream* f)
-{
-	int count = f->readInt32();
-
-	std::vector<T> vec;
-
-	for (int i = 0; i < count; i++)
-	{
-		T elem = f->read<T>();
-		vec.push_back(elem);
-	}
-
-	return vec;
-}
-
-template<typename T>
-void write_vector_rewindable(std::vector<RewindableState<T>> list, MemoryStream* f)
-{
-	int c = list.size();
-	f->writeInt32(c);
-
-	for (int i = 0; i < list.size(); i++)
-	{
-		RewindableState<T> elem = list[i];
-		elem.write(f);
-	}
-}
-
-template<typename T>
-std::vector<RewindableState<T>> read_vector_rewindable(MemoryStream* f)
-{
-	int c = f->readInt32();
-
-	std::vector<RewindableState<T>> vec;
-
-	for (int i = 0; i < c; i++)
-	{
-		vec.push_back(RewindableState<T>::read(f));
-	}
-
-	return vec;
-}
-
-std::vector<int> read_list_int(MemoryStream* f)
-{
-	std::string list = f->readString();
-	list.erase(list.begin());
-	list.erase(list.end());
-
-	std::vector<std::string> elemlist = SplitStringDelim(list, ',');
-
-	std::vector<int> out;
-
-	for (int i = 0; i < elemlist.size(); i++)
-		out.push_back(atoi(elemlist[i].c_str()));
-
-	return out;
-}
-
-std::vector<int> read_list_powerupstates(MemoryStream* f)
-{
-	std::string list = f->readString();
-	list.erase(list.begin());
-	list.erase(list.end());
-
-	std::vector<std::string> elemlist = SplitStringDelim(list, ';');
-
-	std::vector<int> out;
-
-	for (int i = 0; i < elemlist.size(); i++)
-		out.push_back(atoi(elemlist[i].c_str()));
-
-	return out;
-}
-
-std::vector<float> read_list_float(MemoryStream* f)
-{
-	std::string list = f->readString();
-	list.erase(list.begin());
-	list.erase(list.end());
-
-	std::vector<std::string> elemlist = SplitStringDelim(list, ',');
-
-	std::vector<float> out;
-
-	for (int i = 0; i < elemlist.size(); i++)
-		out.push_back(atof(elemlist[i].c_str()));
-
-	return out;
-}
-
-std::vector<MPState> read_list_mpstates(MemoryStream* f)
-{
-	std::string list = f->readString();
-	list.erase(list.begin());
-	list.erase(list.end());
-	std::vector<std::string> states = SplitStringDelim(list, ';');
-
-	std::vector<MPState> out;
-
-	for (int i = 0; i < states.size(); i++)
-	{
-		MPState s;
-		sscanf(states[i].c_str(), "%f,%f", &s.pathPosition, &s.targetPosition);
-		out.push_back(s);
-	}
-
-	return out;
-
-}
-
-std::vector<std::string> SplitStringDelim(std::string str,char delim)
-{
-	const char* cstr = str.c_str();
-
-	char* inputstr = (char*)malloc(strlen(cstr) + 1);
-	strcpy(inputstr, cstr);
-
-	std::vector<std::string> out;
-
-	char* splitstr = strtok(inputstr, &delim);
-
-	if (splitstr != NULL)
-	{
-		while (splitstr != NULL)
-		{
-			out.push_back(std::string(splitstr));
-			splitstr = strtok(NULL, &delim);
-		}
-	}
-
-	return out;
-}
-
+// The interpolation helpers below write into out rather than returning, out is usually a scratch frame whose buffers are already big enough
 template<typename T>
-std::vector<T> InterpolateList(std::vector<T> one, std::vector<T> two, float ratio)
+void InterpolateList(const std::vector<T>& one, const std::vector<T>& two, float ratio, std::vector<T>* out)
 {
-	std::vector<T> out;
-	for (int i = 0; i < fmin(one.size(),two.size()); i++)
-		out.push_back(one[i] + (two[i] - one[i]) * ratio);
-	return out;
+	out->resize(std::min(one.size(), two.size()));
+	if (!out->empty())
+		lerpSpan(one.data(), two.data(), ratio, out->data(), out->size());
 }
 
 float truncprec(float num, int prec)
@@ -190,12 +32,12 @@ float truncprec(float num, int prec)
 	return truncf(num * powf(10, prec)) / powf(10, prec);
 }
 
-std::vector<MPState> InterpolateMPStates(std::vector<MPState> one, std::vector<MPState> two,std::vector<TGE::PathedInterior*> interiors, float ratio, float deltams)
+void InterpolateMPStates(const std::vector<MPState>& one, const std::vector<MPState>& two, const std::vector<TGE::PathedInterior*>& interiors, float ratio, float deltams, std::vector<MPState>* out)
 {
-	std::vector<MPState> out;
+	out->resize(interiors.size());
 	for (int i = 0; i < interiors.size(); i++)
 	{
-		MPState s;
+		MPState& s = (*out)[i];
 		TGE::PathedInterior* pClient = interiors[i];
 
 		float proposedPosition = one[i].pathPosition + (two[i].pathPosition - one[i].pathPosition) * ratio;
@@ -269,12 +111,10 @@ std::vector<MPState> InterpolateMPStates(std::vector<MPState> one, std::vector<M
 		}
 
 		s.targetPosition = (ratio > 0.5) ? two[i].targetPosition : one[i].targetPosition;//one[i].targetPosition + (two[i].targetPosition - one[i].targetPosition) * ratio;
-		out.push_back(s);
 	}
-	return out;
 }
 
-float InterpolateNextStateTimer(Frame one, Frame two, float ratio)
+float InterpolateNextStateTimer(const Frame& one, const Frame& two, float ratio)
 {
 	bool isReplay = TGE::Con::getBoolVariable("$Rewind::IsReplay"); // Check the order of the frames
 	// two > one for normal rewind aka two is older than one
@@ -316,7 +156,7 @@ float InterpolateNextStateTimer(Frame one, Frame two, float ratio)
 }
 
 template<typename T>
-bool CompareListEquality(std::vector<T> one, std::vector<T> two)
+bool CompareListEquality(const std::vector<T>& one, const std::vector<T>& two)
 {
 	//if (one.size() != two.size())
 	//	return false;
@@ -331,33 +171,34 @@ bool CompareListEquality(std::vector<T> one, std::vector<T> two)
 }
 
 #ifdef MBP
-bool CheckForTeleport(TeleportState one, TeleportState two)
+bool CheckForTeleport(const TeleportState& one, const TeleportState& two)
 {
 	return one.teleportCounter != two.teleportCounter;
 }
 
-std::string ChooseNonEmptyString(std::string one, std::string two)
+const std::string& ChooseNonEmptyString(const std::string& one, const std::string& two)
 {
-	if (strcmp(one.c_str(), "") == 0)
+	if (one.empty())
 	{
 		return two;
 	}
 	return one;
 }
 
-TeleportState InterpolateTeleportState(TeleportState one, TeleportState two, float ratio)
+void InterpolateTeleportState(const TeleportState& one, const TeleportState& two, float ratio, TeleportState* out)
 {
-	TeleportState ret;
 	if (!CheckForTeleport(one, two))
-		ret.teleportDelay = mLerp(one.teleportDelay, two.teleportDelay, ratio);
+		out->teleportDelay = mLerp(one.teleportDelay, two.teleportDelay, ratio);
 	else
-		ret.teleportDelay = (ratio > 0.5) ? two.teleportDelay : one.teleportDelay;
-	ret.destination = (ret.teleportDelay > 0) ? ChooseNonEmptyString(one.destination, two.destination) : std::string(); //(ratio > 0.5) ? two.destination : one.destination;
-	ret.teleportCounter = (ratio > 0.5) ? two.teleportCounter : one.teleportCounter;
-	return ret;
+		out->teleportDelay = (ratio > 0.5) ? two.teleportDelay : one.teleportDelay;
+	if (out->teleportDelay > 0)
+		out->destination = ChooseNonEmptyString(one.destination, two.destination);
+	else
+		out->destination.clear(); //(ratio > 0.5) ? two.destination : one.destination;
+	out->teleportCounter = (ratio > 0.5) ? two.teleportCounter : one.teleportCounter;
 }
 
-bool CheckForRespawn(CheckpointState one, CheckpointState two)
+bool CheckForRespawn(const CheckpointState& one, const CheckpointState& two)
 {
 	return one.respawnCounter != two.respawnCounter;
 }
@@ -387,130 +228,293 @@ RewindManager::~RewindManager()
 {
 	if (this->pathedInteriors != NULL)
 		deleteSafe(this->pathedInteriors);
+	closeReader();
+	stopRecording();
+}
+
+void RewindManager::closeReader()
+{
+	if (this->reader != NULL)
+	{
+		delete this->reader;
+		this->reader = NULL;
+	}
+}
+
+// Decodes a streamed replay into Frames for the code paths that need every frame at hand
+void RewindManager::materialize()
+{
+	if (this->reader == NULL)
+		return;
+
+	DebugPush("Entering RewindManager::materialize");
+	decodeReplay();
+	DebugPop("Leaving RewindManager::materialize");
 }
 
 
 void RewindManager::pushFrame(Frame f)
 {
-	Frames.push_back(f);
+	materialize();
+	Frames.push(f);
+	thinLastFrame();
+	// Only the last frame can still get thinned away, everything before it is final unless the player rewinds
+	if (this->recording)
+		recordFrames(Frames.size() - 1);
+	// Older blocks never change, so the budget can only be crossed when a new block gets started
+	if (Frames.getBlock(Frames.getBlockCount() - 1).size() == 1)
+		enforceHistoryBudget();
+}
+
+static bool lerpMatches(const Point3D& one, const Point3D& mid, const Point3D& two, float ratio, float tolerance)
+{
+	Point3D lerped(mLerp(one.x, two.x, (F64)ratio), mLerp(one.y, two.y, (F64)ratio), mLerp(one.z, two.z, (F64)ratio));
+	return (lerped - mid).lenSquared() <= tolerance * tolerance;
+}
+
+static bool lerpMatches(float one, float mid, float two, float ratio, float tolerance)
+{
+	return fabs(mLerp(one, two, ratio) - mid) <= tolerance;
+}
+
+// Unset or unknown names keep replays on zlib
+static ReplayCodec getPreferredCodec()
+{
+	return parseReplayCodec(TGE::Con::getVariable("$pref::Rewind::ReplayCodec"));
+}
+
+void RewindManager::recordFrames(int count)
+{
+	if (this->recorder == NULL)
+		this->recorder = new ReplayRecorder();
+	if (this->recordCursor.isEmpty() && count > 0)
+	{
+		this->recorder->setCodec(getPreferredCodec());
+		this->recorder->openJournal(replayPath + REPLAY_PARTIAL_EXTENSION, replayMission, game);
+	}
+
+	for (; this->recordCursor.recorded < count; this->recordCursor.recorded++)
+		this->recorder->append(Frames.get(this->recordCursor.recorded));
+}
+
+void RewindManager::unrecordFrom(int index)
+{
+	int count;
+	switch (this->recordCursor.unrecordFrom(index, &count))
+	{
+	case RecordCursor::UnrecordTruncate:
+		this->recorder->truncate(count);
+		break;
+	case RecordCursor::UnrecordClear:
+		this->recorder->clear();
+		break;
+	default:
+		break;
+	}
+}
+
+void RewindManager::unrecordAll()
+{
+	if (this->recordCursor.unrecordAll() == RecordCursor::UnrecordClear)
+		this->recorder->clear();
+}
+
+void RewindManager::popLastFrame()
+{
+	Frames.popBack();
+	unrecordFrom(Frames.size());
+}
+
+void RewindManager::stopRecording()
+{
+	if (this->recorder != NULL)
+	{
+		delete this->recorder;
+		this->recorder = NULL;
+	}
+	this->recordCursor.reset();
+}
+
+void RewindManager::thinLastFrame()
+{
+	float tolerance = TGE::Con::getFloatVariable("$pref::Rewind::ThinTolerance");
+	if (tolerance <= 0 || Frames.size() < 3)
+		return;
+
+	int two = Frames.size() - 1;
+	int mid = two - 1;
+	int one = mid - 1;
+
+	// Discrete state can't be interpolated, keep every frame where something changes
+	if (!Frames.sameStateAsPrevious(two) || !Frames.sameStateAsPrevious(mid))
+		return;
+
+	int midDelta = Frames.getDeltaMs(mid);
+	int totalDelta = midDelta + Frames.getDeltaMs(two);
+	if (totalDelta <= 0)
+		return;
+	float ratio = (float)midDelta / (float)totalDelta;
+
+	// Timers are in ms, a millisecond off is as good as exact
+	if (!lerpMatches(Frames.getMs(one), Frames.getMs(mid), Frames.getMs(two), ratio, 1)
+		|| !lerpMatches(Frames.getElapsedTime(one), Frames.getElapsedTime(mid), Frames.getElapsedTime(two), ratio, 1)
+		|| !lerpMatches(Frames.getTimebonus(one), Frames.getTimebonus(mid), Frames.getTimebonus(two), ratio, 1)
+		|| !lerpMatches(Frames.getNextStateTime(one), Frames.getNextStateTime(mid), Frames.getNextStateTime(two), ratio, 1))
+		return;
+
+	if (!lerpMatches(Frames.getPosition(one), Frames.getPosition(mid), Frames.getPosition(two), ratio, tolerance)
+		|| !lerpMatches(Frames.getVelocity(one), Frames.getVelocity(mid), Frames.getVelocity(two), ratio, tolerance)
+		|| !lerpMatches(Frames.getSpin(one), Frames.getSpin(mid), Frames.getSpin(two), ratio, tolerance))
+		return;
+
+	int mpCount = Frames.getMPStateCount(mid);
+	if (Frames.getMPStateCount(one) != mpCount || Frames.getMPStateCount(two) != mpCount)
+		return;
+	for (int i = 0; i < mpCount; i++)
+	{
+		if (!lerpMatches(Frames.getMPState(one, i).pathPosition, Frames.getMPState(mid, i).pathPosition, Frames.getMPState(two, i).pathPosition, ratio, 1))
+			return;
+	}
+
+	Frames.dropSecondToLast();
+}
+
+void RewindManager::enforceHistoryBudget()
+{
+	int maxMemoryMB = TGE::Con::getIntVariable("$pref::Rewind::MaxMemoryMB");
+	int maxSeconds = TGE::Con::getIntVariable("$pref::Rewind::MaxSeconds");
+	if (maxMemoryMB <= 0 && maxSeconds <= 0)
+		return;
+
+	DebugPush("Entering RewindManager::enforceHistoryBudget");
+	bool thin = TGE::Con::getBoolVariable("$pref::Rewind::ThinHistory");
+	// The block we're recording into is left alone
+	while (Frames.getBlockCount() > 1)
+	{
+		bool overMemory = maxMemoryMB > 0 && Frames.getMemoryUsage() > (size_t)maxMemoryMB * 1024 * 1024;
+		bool overTime = maxSeconds > 0 && Frames.getDuration() > maxSeconds * 1000;
+		if (!overMemory && !overTime)
+			break;
+
+		// Thinning keeps the whole duration around, so it only helps with the memory budget
+		int thinnable = -1;
+		if (thin && !overTime)
+		{
+			for (int i = 0; i < Frames.getBlockCount() - 1; i++)
+			{
+				if (!Frames.getBlock(i).isThinned())
+				{
+					thinnable = i;
+					break;
+				}
+			}
+		}
+
+		// Every frame but the last one has been recorded, so the recorder keeps the full run either way
+		int count = Frames.size();
+		if (thinnable != -1)
+		{
+			Frames.thinBlock(thinnable, 2);
+			int blockEnd = 0;
+			for (int i = 0; i <= thinnable; i++)
+				blockEnd += Frames.getBlock(i).size();
+			this->recordCursor.thinned(count - Frames.size(), blockEnd);
+		}
+		else
+		{
+			Frames.dropOldestBlock();
+			this->recordCursor.dropped(count - Frames.size());
+		}
+	}
+	DebugPop("Leaving RewindManager::enforceHistoryBudget");
 }
 
 
 Frame RewindManager::popFrame(bool peek)
 {
+	materialize();
 	if (peek)
 		return Frames.back();
 	Frame f = Frames.back();
-	Frames.pop_back();
+	popLastFrame();
 	return f;
 }
 
 
-Frame RewindManager::getFrameAt(int index)
+bool RewindManager::getFrameAt(int index, Frame* out)
 {
-	return Frames.at(index);
+	return getFrameInto(index, out);
 }
 
 int RewindManager::getFrameCount()
 {
+	if (this->reader != NULL)
+		return this->reader->getFrameCount();
 	return Frames.size();
 }
 
-void RewindManager::save(std::string path)
+void RewindManager::save(std::string path, ReplayCodec codec)
 {
 	dispatcher.run([]() { DebugPush("Entering RewindManager::save"); });
 	if (Frames.size() != 0) //We dun wanna save empty files
+	{
+		int framecount = Frames.size();
+		dispatcher.run([=]() { TGE::Con::printf("Saving replay to %s", path.c_str()); });
+		dispatcher.run([=]() { TGE::Con::printf("Frames: %d", framecount); });
+
+		ReplayWriter writer;
+		writer.setCodec(codec);
+		dispatcher.run([]() { TGE::Con::printf("Compressing Replay"); });
+		// Chunks get encoded and compressed in parallel, only a few are ever held uncompressed at once
+		writer.writeFrames(Frames, &threadPool);
+		if (writer.save(path, replayMission, game))
 		{
-			FILE *fMain;
-			fMain = fopen(path.c_str(), "wb");
-			dispatcher.run([=]() { TGE::Con::printf("Saving replay to %s", path.c_str()); });
-			dispatcher.run([=]() { TGE::Con::printf("Frames: %d", Frames.size()); });
-#ifdef  MBP
-			char version = 12;
-#else
-			char version = 11;
-#endif
-			fwrite(&version, sizeof(char), 1, fMain); //Yeah have to write the version
-
-			dispatcher.run([]() { TGE::Con::printf("Compressing Replay"); });
-			MemoryStream m;
-
-			int framecount = Frames.size();
-
-			m.writeInt32(framecount);
-			m.writeString(replayMission);
-			m.writeString(game);
-			while (Frames.size() > 0)
-			{
-				Frame frame = Frames.at(Frames.size() - 1);
-
-				m.writeInt32(frame.ms);
-				m.writeInt32(frame.deltaMs);
-				m.writeDouble(frame.position.x);
-				m.writeDouble(frame.position.y);
-				m.writeDouble(frame.position.z);
-				m.writeDouble(frame.velocity.x);
-				m.writeDouble(frame.velocity.y);
-				m.writeDouble(frame.velocity.z);
-				m.writeDouble(frame.spin.x);
-				m.writeDouble(frame.spin.y);
-				m.writeDouble(frame.spin.z);
-				m.writeInt32(frame.powerup);
-				m.writeInt32(frame.timebonus);
-				write_list_mpstates(frame.mpstates, &m);
-				m.writeInt32(frame.gemcount);
-				write_vector(frame.gemstates, &m);
-				write_vector(frame.ttstates, &m);
-				write_vector(frame.powerupstates, &m);
-				m.writeString(frame.gamestate);
-				write_vector(frame.lmstates, &m);
-				m.writeInt32(frame.nextstatetime);
-				write_vector(frame.activepowstates, &m);
-				m.writeString(frame.gravityDir);
-				write_vector(frame.trapdoordirs, &m);
-				write_vector(frame.trapdooropen, &m);
-				write_vector(frame.trapdoorclose, &m);
-				write_vector(frame.trapdoorpos, &m);
-#ifdef  MBP
-				m.writeInt32(frame.teleportState.teleportDelay);
-				m.writeString(frame.teleportState.destination);
-				m.writeInt32(frame.teleportState.teleportCounter);
-				m.writeBool(frame.eggstate);
-#endif //  MBP
-				write_vector_rewindable(frame.rewindableIntStates, &m);
-				write_vector_rewindable(frame.rewindableFloatStates, &m);
-				write_vector_rewindable(frame.rewindableBoolStates, &m);
-				write_vector_rewindable(frame.rewindableStringStates, &m);
-
-				write_vector_rewindable(frame.rewindableSOIntStates, &m);
-				write_vector_rewindable(frame.rewindableSOFloatStates, &m);
-				write_vector_rewindable(frame.rewindableSOBoolStates, &m);
-				write_vector_rewindable(frame.rewindableSOStringStates, &m);
-
-				Frames.pop_back();
-			}
-			auto size = m.length();
-			auto sz = compressBound(size + 1);
-			Bytef* mem = new Bytef[sz + 1];
-			compress(mem, &sz, m.getBuffer(), m.length());
-			dispatcher.run([=]() { TGE::Con::printf("Completed Compression:%d bytes", sz); });
-			fwrite(&size, sizeof(unsigned long), 1, fMain); //We gotta write the size of uncompressed replay so that we can allocate enough memory to uncompress the compressed replay
-			fwrite(mem, 1, sz, fMain);
-			fclose(fMain); //DONE
-			delete[] mem;
+			updateReplayIndex(path);
+			dispatcher.run([]() { TGE::Con::printf("Completed Compression"); });
 		}
+		Frames.clear();
+	}
 	dispatcher.run([]() { DebugPop("Leaving RewindManager::save"); });
 	dispatcher.run([]() { TGE::Con::executef(1, "OnReplaySaved"); });
 	dispatcher.run([]() { TGE::Con::evaluatef("setModPaths(getModPaths());"); });
 }
 
+void ReplayLoadLog::add(bool error, std::string message)
+{
+	this->messages.push_back(std::make_pair(error, message));
+}
+
+void ReplayLoadLog::print() const
+{
+	for (auto& message : this->messages)
+	{
+		if (message.first)
+			TGE::Con::errorf("%s", message.second.c_str());
+		else
+			TGE::Con::printf("%s", message.second.c_str());
+	}
+}
+
 std::string RewindManager::load(std::string path,bool isGhost)
 {
 	DebugPush("Entering RewindManager::load(%s,%d)", path.c_str(), isGhost);
+	ReplayLoadLog log;
+	std::string mission = loadReplayFile(path, isGhost, &log);
+	log.print();
+	resolveRewindableBindings();
+	DebugPop("Leaving RewindManager::load");
+	return mission;
+}
+
+std::string RewindManager::loadReplayFile(std::string path, bool isGhost, ReplayLoadLog* log)
+{
+	unrecordAll();
+	this->recording = false;
 	Frames.clear();
+	closeReader();
 	this->totalTime = 0;
 
-	clearSaveStates();
+	SaveStates.clear();
 
 	FILE *f;
 
@@ -521,485 +525,346 @@ std::string RewindManager::load(std::string path,bool isGhost)
 
 	f = fopen(path.c_str(), "rb");
 
-	fseek(f, 0, SEEK_END);
-	long size = ftell(f);
-	fseek(f, 0, SEEK_SET);
-	uint8_t* buffer = new uint8_t[size + 1];
-	fread(buffer, sizeof(uint8_t), size, f);
-	fclose(f);
-
-	MemoryStream m;
-	m.createFromBuffer(buffer, size);
-	fclose(f);
-
 	replayPath = path;
-
-	char version = m.readChar();
-
-	unsigned long uncompressedSize = 52428800; //max uncompressed data size - 50mb, bad idea but replays prob wont go over this
-	if (version >= 3)
-		uncompressedSize = m.readInt32();
-
 	replayMission = std::string("[null]");
 
-	if (version >= 2)
+	if (f == NULL)
 	{
-		TGE::Con::printf("Uncompressing Replay");
-
-		uint8_t* buf = &m.getBuffer()[m.tell()];
-		uint64_t size = m.length();
-		size -= 1; // one byte used by version
-		if (version >= 3)
-			size -= sizeof(unsigned long);
-
-		uint8_t* uncompressed = new uint8_t[uncompressedSize + 1];
-
-		uncompress((Bytef*)uncompressed, &uncompressedSize, (Bytef*)buf, size);
-
-		m.createFromBuffer(uncompressed, uncompressedSize);
-
-
+		// A run that crashed before it got saved leaves its journal next to where the replay would have gone
+		f = fopen((path + REPLAY_PARTIAL_EXTENSION).c_str(), "rb");
+		if (f != NULL)
+		{
+			path += REPLAY_PARTIAL_EXTENSION;
+			log->add(false, "Salvaging unfinished replay " + path);
+		}
 	}
-	int framecount = m.readInt32();
-	if (version >= 4)
-		replayMission = m.readString();
-	if (version >= 10)
+
+	if (f == NULL)
 	{
-		std::string replaygame = m.readString();
-		if (replaygame != game)
-			return replayMission; //ERR WRONG REPLAY GAME
+		log->add(true, "Could not open replay " + path);
+		return replayMission;
 	}
 
+	int version = readReplayVersion(f);
+	if (version == -1)
+	{
+		fclose(f);
+		log->add(true, "Replay " + path + " is corrupt");
+		return replayMission;
+	}
 
-	int i;
-	for (i = 0; i < framecount; i++)
+	// Ghosts drop their stopped time frames while loading, which a streamed replay can't do. They go through loadChunked instead
+	if (version >= REPLAY_VERSION_INDEXED && !isGhost)
 	{
-		int ms, deltaMs;
-		ms = m.readInt32();
-		deltaMs = m.readInt32();
-		//TGE::Con::printf("Loaded Time: %d %d", ms,deltaMs);
-		double px, py, pz, vx, vy, vz, sx, sy, sz;
-		px = m.readDouble();
-		py = m.readDouble();
-		pz = m.readDouble();
-		Point3D position = Point3D(px, py, pz);
-		//TGE::Con::printf("Loaded Pos: %lf %lf %lf", px, py, pz);
-		vx = m.readDouble();
-		vy = m.readDouble();
-		vz = m.readDouble();
-		Point3D velocity = Point3D(vx, vy, vz);
-		//TGE::Con::printf("Loaded Vel: %lf %lf %lf", vx, vy, vz);
-		sx = m.readDouble();
-		sy = m.readDouble();
-		sz = m.readDouble();
-		Point3D spin = Point3D(sx, sy, sz);
-		//TGE::Con::printf("Loaded Spn: %lf %lf %lf", sx, sy, sz);
-		int pow, timebonus, gemcount;
-		pow = m.readInt32();
-		timebonus = m.readInt32();
-		//TGE::Con::printf("Loaded Pow And TB: %d %d", pow,timebonus);
-		std::vector<MPState> mpstates = read_list_mpstates(&m);
-		//TGE::Con::printf("Loaded MPStates: %s", mpstates.c_str());
-		gemcount = m.readInt32();
-		//TGE::Con::printf("Loaded GC: %d", gemcount);
-		std::vector<int> gemstates, ttstates, powerupstates, lmstates, activepowstates;
-
-		if (version >= 7)
+		// Indexed replays are streamed, frames only get uncompressed once something asks for them
+		fclose(f);
+		this->reader = new ReplayReader();
+		if (!this->reader->open(path))
 		{
-			gemstates = read_vector<int>(&m);
-			ttstates = read_vector<int>(&m);
-			powerupstates = read_vector<int>(&m);
+			log->add(true, "Replay " + path + " is corrupt");
+			closeReader();
+			return replayMission;
 		}
-		else
+		replayMission = this->reader->getHeader().mission;
+		if (this->reader->getHeader().game != game)
 		{
-			gemstates = read_list_int(&m);
-			//TGE::Con::printf("Loaded MPStates: %s", mpstates.c_str());
-			ttstates = read_list_int(&m);
-			//TGE::Con::printf("Loaded TTStates: %s", ttstates.c_str());
-			powerupstates = read_list_int(&m);
-			//TGE::Con::printf("Loaded PowStates: %s", powerupstates.c_str());
+			closeReader();
+			return replayMission; //ERR WRONG REPLAY GAME
 		}
-		std::string gamestate = m.readString();
-		//TGE::Con::printf("Loaded Gametate: %s", gamestate.c_str());
-		if (version >= 7)
-			lmstates = read_vector<int>(&m);
-		else
-			lmstates = read_list_int(&m);
-		//TGE::Con::printf("Loaded LMStates: %s", lmstates.c_str());
-		int nextStateTime = m.readInt32();
 
-		if (version >= 7)
-		{
-			activepowstates = read_vector<int>(&m);
-		}
-		else
-			activepowstates = read_list_powerupstates(&m);
-		//TGE::Con::printf("Loaded ActivePowStates: %s", activepowstates.c_str());
-		std::string gravitydir = m.readString();
-		//TGE::Con::printf("Loaded GDirStates: %s", gravitydir.c_str());
-		std::vector<int> trapdoordirs; 
-		std::vector<int> trapdoorclose;
-		std::vector<int> trapdooropen; 
-		std::vector<float>trapdoorpos; 
-		if (version >= 5 && version < 7)
-		{
-			trapdoordirs = read_list_int(&m);
-			trapdooropen = read_list_int(&m);
-			trapdoorclose = read_list_int(&m);
-		}
-		if (version >= 6 && version < 7)
-		{
-			trapdoorpos = read_list_float(&m);
-		}
-		if (version >= 7)
-		{
-			trapdoordirs = read_vector<int>(&m);
-			trapdooropen = read_vector<int>(&m);
-			trapdoorclose = read_vector<int>(&m);
-			trapdoorpos = read_vector<float>(&m);
+		this->totalTime = this->reader->getTotalElapsed();
+		this->currentIndex = this->reader->getFrameCount() - 1;
+		this->streamTimePosition = 0;
+		this->averageDelta = (float)this->totalTime / this->reader->getFrameCount();
+		log->add(false, "Loaded replay " + replayPath + ", " + std::to_string(this->reader->getFrameCount()) + " Frames");
+		return replayMission;
+	}
 
+	if (version >= REPLAY_VERSION_CHUNKED)
+	{
+		std::string mission;
+		try
+		{
+			mission = loadChunked(f, isGhost, log);
 		}
-#ifdef MBP
-		TeleportState ts;
-		if (version >= 8)
+		catch (std::runtime_error&)
 		{
-			ts.teleportDelay = m.readInt32();
-			ts.destination = m.readString();
-			if (version >= 9)
-				ts.teleportCounter = m.readInt32();
+			log->add(true, "Replay " + path + " is corrupt");
+			mission = replayMission;
 		}
-		bool eggstate = false;
-		if (version >= 12)
-			eggstate = m.readBool();
-
-#endif // MBP
+		fclose(f);
+		return mission;
+	}
 
-		std::vector<RewindableState<int>> rewindableIntStates;
-		std::vector<RewindableState<float>> rewindableFloatStates;
-		std::vector<RewindableState<bool>> rewindableBoolStates;
-		std::vector<RewindableState<std::string>> rewindableStringStates;
+	fclose(f);
 
-		std::vector<RewindableState<int>> rewindableSOIntStates;
-		std::vector<RewindableState<float>> rewindableSOFloatStates;
-		std::vector<RewindableState<bool>> rewindableSOBoolStates;
-		std::vector<RewindableState<std::string>> rewindableSOStringStates;
+	MappedFile file;
+	MemoryStream m;
+	try
+	{
+		version = openLegacyReplay(path, &file, &m);
+	}
+	catch (std::runtime_error&)
+	{
+		version = -1;
+	}
+	if (version == -1)
+	{
+		log->add(true, "Replay " + path + " is corrupt");
+		return replayMission;
+	}
 
-		if (version == 10)
-		{
-			m.readInt32();
-			m.readInt32();
-		}
-		if (version >= 11)
+	// Legacy replays are stored newest first, collect them so they can go into the store in order
+	std::vector<Frame> frames;
+	std::unordered_set<int> ghostMs;
+	int framecount;
+	int i;
+	try
+	{
+		framecount = m.readInt32();
+		if (version >= 4)
+			replayMission = m.readString();
+		if (version >= 10)
 		{
-			rewindableIntStates = read_vector_rewindable<int>(&m);
-			rewindableFloatStates = read_vector_rewindable<float>(&m);
-			rewindableBoolStates = read_vector_rewindable<bool>(&m);
-			rewindableStringStates = read_vector_rewindable<std::string>(&m);
-
-			rewindableSOIntStates = read_vector_rewindable<int>(&m);
-			rewindableSOFloatStates = read_vector_rewindable<float>(&m);
-			rewindableSOBoolStates = read_vector_rewindable<bool>(&m);
-			rewindableSOStringStates = read_vector_rewindable<std::string>(&m);
+			std::string replaygame = m.readString();
+			if (replaygame != game)
+				return replayMission; //ERR WRONG REPLAY GAME
 		}
 
-		if (deltaMs < 0)
+		for (i = 0; i < framecount; i++)
 		{
-			framecount--;
-			continue;
-		}
-		if (isGhost)
-		{
-			if (hasMs(ms))
+			Frame frame = readFrame(&m, version);
+
+			if (frame.deltaMs < 0)
 			{
-				if (m.tell() >= m.length()) break;
+				framecount--;
 				continue;
 			}
-		}
-		if (isGhost) //Don't add those stopped time frames
-		{
-			if (Frames.size() != 0)
-				if (Frames.back().ms == ms)
+			if (isGhost) //Don't add those stopped time frames
+			{
+				if (!ghostMs.insert(frame.ms).second)
+				{
+					if (m.tell() >= m.length()) break;
 					continue;
-		}
+				}
+			}
 
-		Frame frame = Frame(ms, deltaMs, position, velocity, spin, pow, timebonus, mpstates, gemcount, gemstates, ttstates, powerupstates, gamestate, lmstates, nextStateTime, activepowstates, gravitydir, trapdoordirs, trapdooropen, trapdoorclose, trapdoorpos
-#ifdef MBP
-			, ts //Too hackery
-			, CheckpointState() //Yeah uh we arent saving checkpoint states
-			, eggstate
-#endif // MBP
-		);
-
-		frame.rewindableIntStates = rewindableIntStates;
-		frame.rewindableFloatStates = rewindableFloatStates;
-		frame.rewindableBoolStates = rewindableBoolStates;
-		frame.rewindableStringStates = rewindableStringStates;
-		frame.rewindableSOIntStates = rewindableSOIntStates;
-		frame.rewindableSOFloatStates = rewindableSOFloatStates;
-		frame.rewindableSOBoolStates = rewindableSOBoolStates;
-		frame.rewindableSOStringStates = rewindableSOStringStates;
-
-		Frames.push_back(frame);
-		if (m.tell() >= m.length()) break;
+			frames.push_back(frame);
+			if (m.tell() >= m.length()) break;
+		}
+	}
+	catch (std::runtime_error&)
+	{
+		// These are newest first, the frames that did read are the end of the run and useless on their own
+		log->add(true, "Replay " + path + " is corrupt");
+		return replayMission;
 	}
 
+	for (auto it = frames.rbegin(); it != frames.rend(); it++)
+		Frames.push(*it);
 
-	TGE::Con::printf("Loaded replay %s, %d Frames", replayPath.c_str(), framecount);
+	log->add(false, "Loaded replay " + replayPath + ", " + std::to_string(framecount) + " Frames");
 	setFrameElapsedTimes();
-	std::reverse(Frames.begin(), Frames.end());
 	setUpFrameStreaming();
-	DebugPop("Leaving RewindManager::load");
 	return replayMission.c_str();
 }
 
-ReplayInfo RewindManager::analyze(std::string path)
+void RewindManager::decodeReplay()
 {
-	DebugPush("Entering RewindManager::analyzze(%s)", path.c_str());
+	if (this->reader == NULL)
+		return;
+
+	unrecordAll();
 	Frames.clear();
-	this->totalTime = 0;
+	this->reader->readAll(&Frames, &threadPool);
+	closeReader();
+}
 
+void RewindManager::takeReplay(RewindManager* other)
+{
+	DebugPush("Entering RewindManager::takeReplay");
+	unrecordAll();
+	this->recording = false;
+	closeReader();
 	clearSaveStates();
+	std::swap(this->Frames, other->Frames);
+	std::swap(this->reader, other->reader);
+	this->replayPath = other->replayPath;
+	this->replayMission = other->replayMission;
+	this->totalTime = other->totalTime;
+	this->currentIndex = other->currentIndex;
+	this->streamTimePosition = other->streamTimePosition;
+	this->averageDelta = other->averageDelta;
+	other->Frames.clear();
+	other->closeReader();
+	// other resolved against its own bindings, if it had any
+	resolveRewindableBindings();
+	DebugPop("Leaving RewindManager::takeReplay");
+}
 
-	FILE* f;
-
-	ReplayInfo info;
-
-
-#ifdef  __APPLE__
-	std::replace(path.begin(), path.end(), '\\', '/');
-#endif //  __APPLE__
-
-	f = fopen(path.c_str(), "rb");
-
-	fseek(f, 0, SEEK_END);
-	long size = ftell(f);
-	fseek(f, 0, SEEK_SET);
-	uint8_t* buffer = new uint8_t[size + 1];
-	fread(buffer, sizeof(uint8_t), size, f);
-	fclose(f);
-
-	MemoryStream m;
-	m.createFromBuffer(buffer, size);
-	fclose(f);
-
-	info.replayPath = path;
-
-	char version = m.readChar();
-	info.version = version;
-
-	unsigned long uncompressedSize = 52428800; //max uncompressed data size - 50mb, bad idea but replays prob wont go over this
-	if (version >= 3)
-		uncompressedSize = m.readInt32();
-
-	info.replayMission = std::string("[null]");
-
-	if (version >= 2)
-	{
-		TGE::Con::printf("Uncompressing Replay");
-
-		uint8_t* buf = &m.getBuffer()[m.tell()];
-		uint64_t size = m.length();
-		size -= 1; // one byte used by version
-		if (version >= 3)
-			size -= sizeof(unsigned long);
-
-		uint8_t* uncompressed = new uint8_t[uncompressedSize + 1];
-
-		uncompress((Bytef*)uncompressed, &uncompressedSize, (Bytef*)buf, size);
-
-		m.createFromBuffer(uncompressed, uncompressedSize);
-
-
-	}
-	int framecount = m.readInt32();
-	info.frameCount = framecount;
-	if (version >= 4)
-		info.replayMission = m.readString();
-	if (version >= 10)
+std::string RewindManager::loadChunked(FILE* f, bool isGhost, ReplayLoadLog* log)
+{
+	ReplayHeader header;
+	std::vector<ReplayChunkInfo> chunks;
+	if (!readReplayHeader(f, &header) || !readReplayChunkIndex(f, &header, &chunks))
 	{
-		std::string replaygame = m.readString();
+		log->add(true, "Replay " + replayPath + " is corrupt");
+		return replayMission;
 	}
 
+	replayMission = header.mission;
+	if (header.game != game)
+		return replayMission; //ERR WRONG REPLAY GAME
 
-	int i;
-	info.elapsedTime = 0;
-	info.time = 0;
-	for (i = 0; i < framecount; i++)
+	// Chunks get uncompressed and decoded in parallel, then go into the store in order
+	bool complete = readReplayChunks(f, header, chunks, &threadPool, [&](int index, std::vector<Frame>& frames)
 	{
-		int ms, deltaMs;
-		ms = m.readInt32();
-		deltaMs = m.readInt32();
-
-		if (i == 0)
-			info.time = ms;
-		info.elapsedTime += deltaMs;
-
-		//TGE::Con::printf("Loaded Time: %d %d", ms,deltaMs);
-		m.readDouble();
-		m.readDouble();
-		m.readDouble();
-		m.readDouble();
-		m.readDouble();
-		m.readDouble();
-		m.readDouble();
-		m.readDouble();
-		m.readDouble();
-		m.readInt32();
-		m.readInt32();
-
-		read_list_mpstates(&m);
-		m.readInt32();
-
-		if (version >= 7)
-		{
-			read_vector<int>(&m);
-			read_vector<int>(&m);
-			read_vector<int>(&m);
-		}
-		else
-		{
-			read_list_int(&m);
-			read_list_int(&m);
-			read_list_int(&m);
-		}
-		m.readString();
-
-		if (version >= 7)
-			read_vector<int>(&m);
-		else
-			read_list_int(&m);
-		m.readInt32();
-
-		if (version >= 7)
-		{
-			read_vector<int>(&m);
-		}
-		else
-			read_list_powerupstates(&m);
-		m.readString();
-		if (version >= 5 && version < 7)
-		{
-			read_list_int(&m);
-			read_list_int(&m);
-			read_list_int(&m);
-		}
-		if (version >= 6 && version < 7)
-		{
-			read_list_float(&m);
-		}
-		if (version >= 7)
+		for (auto& frame : frames)
 		{
-			read_vector<int>(&m);
-			read_vector<int>(&m);
-			read_vector<int>(&m);
-			read_vector<float>(&m);
-		}
-#ifdef MBP
-		TeleportState ts;
-		if (version >= 8)
-		{
-			m.readInt32();
-			m.readString();
-			if (version >= 9)
-				m.readInt32();
-		}
-		if (version >= 12)
-			m.readBool();
-
-#endif // MBP
-
+			if (frame.deltaMs < 0)
+				continue;
 
-		if (version == 10)
-		{
-			m.readInt32();
-			m.readInt32();
-		}
-		if (version >= 11)
-		{
-			read_vector_rewindable<int>(&m);
-			read_vector_rewindable<float>(&m);
-			read_vector_rewindable<bool>(&m);
-			read_vector_rewindable<std::string>(&m);
-
-			read_vector_rewindable<int>(&m);
-			read_vector_rewindable<float>(&m);
-			read_vector_rewindable<bool>(&m);
-			read_vector_rewindable<std::string>(&m);
+			if (isGhost) //Don't add those stopped time frames, the newest one wins just like in the old format
+			{
+				while (Frames.size() != 0 && Frames.getMs(Frames.size() - 1) >= frame.ms)
+					Frames.popBack();
+			}
+			Frames.push(frame);
 		}
+	});
+	if (!complete)
+		log->add(true, "Replay " + replayPath + " is corrupt, only the frames before that got loaded");
 
-		if (deltaMs < 0)
-		{
-			framecount--;
-			continue;
-		}
+	setFrameElapsedTimes();
 
-		if (m.tell() >= m.length()) break;
-		}
+	log->add(false, "Loaded replay " + replayPath + ", " + std::to_string(Frames.size()) + " Frames");
+	setUpFrameStreaming();
+	return replayMission;
+}
 
+ReplayInfo RewindManager::analyze(std::string path)
+{
+#ifdef  __APPLE__
+	std::replace(path.begin(), path.end(), '\\', '/');
+#endif //  __APPLE__
 
-	DebugPop("Leaving RewindManager::analyze");
+	ReplayInfo info;
+	bool analyzed;
+	try
+	{
+		analyzed = analyzeReplayFile(path, &info);
+	}
+	catch (std::runtime_error&)
+	{
+		analyzed = false;
+	}
+	if (!analyzed)
+		dispatcher.run([=]() { TGE::Con::errorf("Could not analyze replay %s", path.c_str()); });
+	updateReplayIndex(path, analyzed ? &info : NULL);
 	return info;
 }
 
-void RewindManager::clear(bool write, Worker* worker)
+void RewindManager::clear(bool write)
 {
 	DebugPush("Entering RewindManager::clear(%d)", write);
 	if (write)
 	{
-		RewindManager* copy = new RewindManager(*this);
-		worker->addTask([=]() {
-			copy->save(replayPath);
-			deleteSafe(copy);
-			// DebugPop("Leaving RewindManager::clear");
+		materialize();
+		// The last frame is final now too. Everything else has been encoded during the run already
+		recordFrames(Frames.size());
+		TGE::Con::printf("Saving replay to %s", replayPath.c_str());
+		std::string path = replayPath;
+		this->recorder->save(path, replayMission, game, [=](bool saved) {
+			if (saved)
+			{
+				updateReplayIndex(path);
+				dispatcher.run([=]() { TGE::Con::printf("Saved replay %s", path.c_str()); });
+			}
+			else
+				dispatcher.run([=]() { TGE::Con::errorf("Could not write replay %s", path.c_str()); });
+			dispatcher.run([]() { TGE::Con::executef(1, "OnReplaySaved"); });
+			dispatcher.run([]() { TGE::Con::evaluatef("setModPaths(getModPaths());"); });
 			});
 	}
+	else if (this->recorder != NULL)
+		this->recorder->clear();
+	this->recordCursor.reset();
+	// Whatever comes next is a new run
+	this->recording = true;
 
 	this->Frames.clear();
+	closeReader();
 	this->pathedInteriors = NULL;
 	this->totalTime = 0;
 	DebugPop("Leaving RewindManager::clear");
 }
 
-template<typename T>
-RewindableState<T> RewindManager::InterpolateRewindableState(RewindableState<T> one, RewindableState<T> two, float ratio, float delta)
+void RewindManager::resolveRewindableBindings()
 {
-	DebugPush("Entering RewindManager::InterpolateRewindableState(%s,%f,%f)", one.bindingnamespace.c_str(), "", ratio, delta);
-	RewindableBindingBase* binding = NULL;
+	DebugPush("Entering RewindManager::resolveRewindableBindings");
+	// Indexed by namespace id, the first binding wins if a namespace got registered twice
+	std::vector<int> indices;
 	for (int i = 0; i < this->rewindableBindings.size(); i++)
 	{
-		if (rewindableBindings[i]->BindingNamespace == one.bindingnamespace)
-		{
-			binding = rewindableBindings[i];
-			break;
-		}
+		int id = rewindableBindings[i]->NamespaceId;
+		if (id >= indices.size())
+			indices.resize(id + 1, -1);
+		if (indices[id] == -1)
+			indices[id] = i;
 	}
+	auto resolve = [indices](int namespaceId)
+	{
+		return (namespaceId >= 0 && namespaceId < indices.size()) ? indices[namespaceId] : -1;
+	};
+
+	Frames.resolveRewindableBindings(resolve);
+	for (auto& state : SaveStates)
+		state.resolveRewindableBindings(resolve);
+	if (this->reader != NULL)
+		this->reader->setBindingResolver(resolve);
+	DebugPop("Leaving RewindManager::resolveRewindableBindings");
+}
 
-	if (binding == NULL)
+template<typename T>
+void RewindManager::InterpolateRewindableState(const RewindableState<T>& one, const RewindableState<T>& two, float ratio, float delta, RewindableState<T>* out)
+{
+	// Runs for every state of every interpolated frame, the binding index was resolved up front so there's no lookup or logging here
+	if (one.bindingIndex < 0 || one.bindingIndex >= this->rewindableBindings.size())
 	{
-		TGE::Con::errorf("RewindManager::InterpolateRewindableState CANNOT INTERPOLATE FOR NAMESPACE %s", one.bindingnamespace.c_str());
+		TGE::Con::errorf("RewindManager::InterpolateRewindableState CANNOT INTERPOLATE FOR NAMESPACE %s", getRewindableNamespace(one.namespaceId).c_str());
+		*out = one;
+		return;
 	}
 
-	int type = binding->getStorageType();
-
-	RewindableState<T> rs = RewindableState<T>(binding->BindingNamespace);
-
-	RewindableBinding<T>* b = static_cast<RewindableBinding<T>*>(binding);
-	rs.value = b->interpolateState(one.value, two.value, ratio, delta);
-	DebugPop("Leaving RewindManager::InterpolateRewindableState()");
-	return rs;
+	RewindableBinding<T>* b = static_cast<RewindableBinding<T>*>(this->rewindableBindings[one.bindingIndex]);
+	out->namespaceId = one.namespaceId;
+	out->bindingIndex = one.bindingIndex;
+	out->value = b->interpolateState(one.value, two.value, ratio, delta);
+}
 
+template<typename T>
+void RewindManager::InterpolateRewindableStates(const std::vector<RewindableState<T>>& one, const std::vector<RewindableState<T>>& two, float ratio, float delta, std::vector<RewindableState<T>>* out)
+{
+	// RewindableState has no default constructor, so grow by copying and only ever assign into the states already there
+	if (out->size() > one.size())
+		out->erase(out->begin() + one.size(), out->end());
+	while (out->size() < one.size())
+		out->push_back(one[out->size()]);
+	for (int i = 0; i < one.size(); i++)
+		InterpolateRewindableState(one[i], two[i], ratio, delta, &(*out)[i]);
 }
 
-Frame RewindManager::interpolateFrame(Frame one,Frame two,float ratio,float delta)
+void RewindManager::interpolateFrame(const Frame& one, const Frame& two, float ratio, float delta, Frame* out)
 {
 	if (ratio > 1 || ratio < 0)
 	{
 		// Yeah uh we aint handling this shit, go crash
 		assert(false);
 	}
+	assert(out != &one && out != &two);
 
 	DebugPush("Entering RewindManager::interpolateFrame(one,two,%f,%f)", ratio,delta);
-	Frame f = Frame();
+	Frame& f = *out;
 	f.deltaMs = delta;
 
 	if (one.timebonus > 0 && two.timebonus > 0)
@@ -1038,199 +903,129 @@ Frame RewindManager::interpolateFrame(Frame one,Frame two,float ratio,float delt
 
 
 	if (pathedInteriors != NULL)
-		f.mpstates = InterpolateMPStates(one.mpstates, two.mpstates, *pathedInteriors, ratio,delta);
+		InterpolateMPStates(one.mpstates, two.mpstates, *pathedInteriors, ratio, delta, &f.mpstates);
 	else
-		f.mpstates = std::vector<MPState>();
+		f.mpstates.clear();
 	f.gemcount = two.gemcount;
 	f.gemstates = two.gemstates;
 	f.ttstates = two.ttstates;
-	f.powerupstates = InterpolateList<int>(one.powerupstates, two.powerupstates, ratio);
+	InterpolateList<int>(one.powerupstates, two.powerupstates, ratio, &f.powerupstates);
 	f.gamestate = two.gamestate;
-	f.lmstates = InterpolateList<int>(one.lmstates, two.lmstates, ratio);
+	InterpolateList<int>(one.lmstates, two.lmstates, ratio, &f.lmstates);
 	f.nextstatetime = mFloor(InterpolateNextStateTimer(one, two, ratio));//mLerp(one.nextstatetime, two.nextstatetime, ratio);
-	f.activepowstates = InterpolateList<int>(one.activepowstates, two.activepowstates, ratio);
+	InterpolateList<int>(one.activepowstates, two.activepowstates, ratio, &f.activepowstates);
 	f.gravityDir = two.gravityDir;
 	f.trapdoordirs = two.trapdoordirs;
-	f.trapdooropen = InterpolateList<int>(one.trapdooropen, two.trapdooropen, ratio);
-	f.trapdoorclose = InterpolateList<int>(one.trapdoorclose, two.trapdoorclose, ratio);
-	f.trapdoorpos = InterpolateList<float>(one.trapdoorpos, two.trapdoorpos, ratio);
+	InterpolateList<int>(one.trapdooropen, two.trapdooropen, ratio, &f.trapdooropen);
+	InterpolateList<int>(one.trapdoorclose, two.trapdoorclose, ratio, &f.trapdoorclose);
+	InterpolateList<float>(one.trapdoorpos, two.trapdoorpos, ratio, &f.trapdoorpos);
 	f.elapsedTime = mLerp(one.elapsedTime, two.elapsedTime, ratio);
 #ifdef  MBP
-	f.teleportState = InterpolateTeleportState(one.teleportState, two.teleportState, ratio);
+	InterpolateTeleportState(one.teleportState, two.teleportState, ratio, &f.teleportState);
 	f.checkpointState = (ratio > 0.5) ? two.checkpointState : one.checkpointState;
 	f.eggstate = (ratio > 0.5) ? two.eggstate : one.eggstate;
 #endif //  MBP
 
-#ifdef WIN32
-#define InterpolateRewindable(type) for (int i = 0; i < one.rewindable##type##States.size(); i++) \
-	f.rewindable##type##States.push_back(InterpolateRewindableState(one.rewindable##type##States[i], two.rewindable##type##States[i], ratio, delta));
-
-	// Epic macro usage
-
-	InterpolateRewindable(Int);
-	InterpolateRewindable(Float);
-	InterpolateRewindable(Bool);
-	InterpolateRewindable(String);
-
-	InterpolateRewindable(SOInt);
-	InterpolateRewindable(SOFloat);
-	InterpolateRewindable(SOBool);
-	InterpolateRewindable(SOString);
+	InterpolateRewindableStates(one.rewindableIntStates, two.rewindableIntStates, ratio, delta, &f.rewindableIntStates);
+	InterpolateRewindableStates(one.rewindableFloatStates, two.rewindableFloatStates, ratio, delta, &f.rewindableFloatStates);
+	InterpolateRewindableStates(one.rewindableBoolStates, two.rewindableBoolStates, ratio, delta, &f.rewindableBoolStates);
+	InterpolateRewindableStates(one.rewindableStringStates, two.rewindableStringStates, ratio, delta, &f.rewindableStringStates);
 
-#undef InterpolateRewindable(type)
-#endif
-#ifdef __APPLE__
-	for (int i = 0; i < one.rewindableIntStates.size(); i++)
-		f.rewindableIntStates.push_back(InterpolateRewindableState(one.rewindableIntStates[i], two.rewindableIntStates[i], ratio, delta));
-	for (int i = 0; i < one.rewindableFloatStates.size(); i++)
-		f.rewindableFloatStates.push_back(InterpolateRewindableState(one.rewindableFloatStates[i], two.rewindableFloatStates[i], ratio, delta));
-	for (int i = 0; i < one.rewindableBoolStates.size(); i++)
-		f.rewindableBoolStates.push_back(InterpolateRewindableState(one.rewindableBoolStates[i], two.rewindableBoolStates[i], ratio, delta));
-	for (int i = 0; i < one.rewindableStringStates.size(); i++)
-		f.rewindableStringStates.push_back(InterpolateRewindableState(one.rewindableStringStates[i], two.rewindableStringStates[i], ratio, delta));
-
-	for (int i = 0; i < one.rewindableSOIntStates.size(); i++)
-		f.rewindableSOIntStates.push_back(InterpolateRewindableState(one.rewindableSOIntStates[i], two.rewindableSOIntStates[i], ratio, delta));
-	for (int i = 0; i < one.rewindableSOFloatStates.size(); i++)
-		f.rewindableSOFloatStates.push_back(InterpolateRewindableState(one.rewindableSOFloatStates[i], two.rewindableSOFloatStates[i], ratio, delta));
-	for (int i = 0; i < one.rewindableSOBoolStates.size(); i++)
-		f.rewindableSOBoolStates.push_back(InterpolateRewindableState(one.rewindableSOBoolStates[i], two.rewindableSOBoolStates[i], ratio, delta));
-	for (int i = 0; i < one.rewindableSOStringStates.size(); i++)
-		f.rewindableSOStringStates.push_back(InterpolateRewindableState(one.rewindableSOStringStates[i], two.rewindableSOStringStates[i], ratio, delta));
-#endif
+	InterpolateRewindableStates(one.rewindableSOIntStates, two.rewindableSOIntStates, ratio, delta, &f.rewindableSOIntStates);
+	InterpolateRewindableStates(one.rewindableSOFloatStates, two.rewindableSOFloatStates, ratio, delta, &f.rewindableSOFloatStates);
+	InterpolateRewindableStates(one.rewindableSOBoolStates, two.rewindableSOBoolStates, ratio, delta, &f.rewindableSOBoolStates);
+	InterpolateRewindableStates(one.rewindableSOStringStates, two.rewindableSOStringStates, ratio, delta, &f.rewindableSOStringStates);
 	DebugPop("Leaving RewindManager::interpolateFrame");
-	return f;
-
 }
 
-Frame* RewindManager::getRealtimeFrameAtMs(float ms)
+int RewindManager::getFrameKey(int index, bool useElapsed)
 {
-	DebugPush("Entering RewindManager::getRealtimeFrameAtMs(%f)", ms);
-	//basically do a binary search
-
-	if (ms < Frames[0].ms)
-	{
-		return new Frame(Frames[0]);
-		DebugPop("Leaving RewindManager::getRealtimeFrameAtMs");
-	}
-	if (ms > Frames.back().ms)
-	{
-		DebugPop("Leaving RewindManager::getRealtimeFrameAtMs");
-		return new Frame(Frames.back());
-	}
+	if (this->reader != NULL)
+		return useElapsed ? this->reader->getElapsedTime(index) : this->reader->getMs(index);
+	return useElapsed ? Frames.getElapsedTime(index) : Frames.getMs(index);
+}
 
-	int lo = 0, hi = Frames.size() - 1;
-	int m;
+bool RewindManager::getFrameInto(int index, Frame* out)
+{
+	if (this->reader != NULL)
+		return this->reader->getFrame(index, out);
+	Frames.get(index, out);
+	return true;
+}
 
-	int index0 = -1;
-	int index1 = -2;
+// Playback moves a few frames per tick at most, anything further away (scrubbing, seeking) falls back to a binary search
+#define CURSOR_MAX_WALK 8
 
-	while (lo <= hi)
+int RewindManager::seekCursor(float key, bool useElapsed)
+{
+	int count = getFrameCount();
+	int index = std::max(0, std::min(this->cursorIndex, count - 1));
+	int steps = 0;
+	while (index > 0 && getFrameKey(index, useElapsed) > key && steps++ < CURSOR_MAX_WALK)
+		index--;
+	while (index < count - 1 && getFrameKey(index + 1, useElapsed) <= key && steps++ < CURSOR_MAX_WALK)
+		index++;
+
+	if (steps > CURSOR_MAX_WALK)
 	{
-		m = (lo + hi) / 2;
-
-		if (Frames[m].ms < ms)
-			lo = m + 1;
-		else if (Frames[m].ms > ms)
-			hi = m - 1;
-		else
+		int lo = 0, hi = count - 1;
+		while (lo < hi)
 		{
-			index0 = index1 = m;
-			break;
+			int m = (lo + hi + 1) / 2;
+			if (getFrameKey(m, useElapsed) <= key)
+				lo = m;
+			else
+				hi = m - 1;
 		}
+		index = lo;
 	}
+	this->cursorIndex = index;
+	return index;
+}
 
-	if (index0 == index1) //We did find the frame, no need to interpolate
-	{
-		DebugPop("Leaving RewindManager::getRealtimeFrameAtMs");
-		return new Frame(Frames[index0]);
-	}
-
-	if (index0 == -1 && index1 == -2)	//We didnt find the exact frame, need to interpolate
-	{
-		index0 = lo;
-		index1 = hi;
-	}
-
-
-	if (index0 > index1) //Sort the indexes to ascending order
-	{
-		int temp = index0;
-		index0 = index1;
-		index1 = temp;
-	}
+bool RewindManager::getFrameAtKey(float key, bool useElapsed, Frame* out)
+{
+	int count = getFrameCount();
+	if (count == 0)
+		return false;
+
+	int index = seekCursor(key, useElapsed);
+	int key0 = getFrameKey(index, useElapsed);
+	if (key <= key0) // Exact match, or before the first frame
+		return getFrameInto(index, out);
+	if (index == count - 1)
+		return false;
+
+	// A streamed replay ends early if either one is in a broken chunk
+	if (!getFrameInto(index, &this->cursorOne) || !getFrameInto(index + 1, &this->cursorTwo))
+		return false;
+	double ratio = (double)(key - key0) / (double)(getFrameKey(index + 1, useElapsed) - key0);
+	interpolateFrame(this->cursorOne, this->cursorTwo, ratio, key, out);
+	return true;
+}
 
-	double ratio = (double)(ms - Frames[index0].ms) / (double)(Frames[index1].ms - Frames[index0].ms);
+bool RewindManager::getRealtimeFrameAtMs(float ms, Frame* out)
+{
+	DebugPush("Entering RewindManager::getRealtimeFrameAtMs(%f)", ms);
+	bool found = getFrameAtKey(ms, false, out);
+	if (!found && getFrameCount() != 0)
+		found = getFrameInto(getFrameCount() - 1, out);
 	DebugPop("Leaving RewindManager::getRealtimeFrameAtMs");
-	return new Frame(interpolateFrame(Frames[index0], Frames[index1], ratio, ms));
+	return found;
 }
 
-Frame* RewindManager::getFrameAtElapsedMs(float ms)
+bool RewindManager::getFrameAtElapsedMs(float ms, Frame* out)
 {
 	DebugPush("Entering RewindManager::getFrameAtElapsedMs(%f)",ms);
-	// binary search version cause apparently the old algorithm consistently breaks while
-	// scrubbing very specific replays, i have yet to find why it doesnt work for those and what causes those replays in the first place
-	// 8/1/2021: bruh fuck that, lets all forget the garbage that was the old algorithm
-	if (ms < Frames[0].elapsedTime)
-	{
-		DebugPop("Leaving RewindManager::getFrameAtElapsedMs");
-		return new Frame(Frames[0]);
-	}
-	if (ms > Frames.back().elapsedTime)
-	{
-		DebugPop("Leaving RewindManager::getFrameAtElapsedMs");
-		return NULL;
-	}
-
-	int lo = 0, hi = Frames.size() - 1;
-	int m;
-
-	int index0 = -1;
-	int index1 = -2;
-
-	while (lo <= hi)
-	{
-		m = (lo + hi) / 2;
-
-		if (Frames[m].elapsedTime < ms)
-			lo = m + 1;
-		else if (Frames[m].elapsedTime > ms)
-			hi = m - 1;
-		else
-		{
-			index0 = index1 = m;
-			break;
-		}
-	}
-
-	if (index0 == index1) //We did find the frame, no need to interpolate
-	{
-		DebugPop("Leaving RewindManager::getFrameAtElapsedMs");
-		return new Frame(Frames[index0]);
-	}
-
-	if (index0 == -1 && index1 == -2)	//We didnt find the exact frame, need to interpolate
-	{
-		index0 = lo;
-		index1 = hi;
-	}
-
-
-	if (index0 > index1) //Sort the indexes to ascending order
-	{
-		int temp = index0;
-		index0 = index1;
-		index1 = temp;
-	}
-
-	double ratio = (double)(ms - Frames[index0].elapsedTime) / (double)(Frames[index1].elapsedTime - Frames[index0].elapsedTime);
+	bool found = getFrameAtKey(ms, true, out);
 	DebugPop("Leaving RewindManager::getFrameAtElapsedMs");
-	return new Frame(interpolateFrame(Frames[index0], Frames[index1], ratio, ms));
+	return found;
 }
 
 Frame* RewindManager::getFrameAtMs(float ms,int index = -1,bool useElapsed)
 {
 	DebugPush("Entering RewindManager::getFrameAtMs(%f,%d,%d)",ms,index,useElapsed);
+	materialize();
 	if (ms < 0)
 	{
 		DebugPop("Leaving RewindManager::getFrameAtMs");
@@ -1242,7 +1037,7 @@ Frame* RewindManager::getFrameAtMs(float ms,int index = -1,bool useElapsed)
 
 	if (useElapsed)
 	{
-		if (ms < Frames.back().elapsedTime)
+		if (ms < Frames.getElapsedTime(Frames.size() - 1))
 		{
 			DebugPop("Leaving RewindManager::getFrameAtMs");
 			return new Frame(Frames.back());
@@ -1259,7 +1054,7 @@ Frame* RewindManager::getFrameAtMs(float ms,int index = -1,bool useElapsed)
 			index = currentIndex;
 		}
 
-		if (ms < Frames.back().ms)
+		if (ms < Frames.getMs(Frames.size() - 1))
 		{
 			DebugPop("Leaving RewindManager::getFrameAtMs");
 			return new Frame(Frames.back());
@@ -1268,25 +1063,32 @@ Frame* RewindManager::getFrameAtMs(float ms,int index = -1,bool useElapsed)
 
 	for (int i = index;i >= 0; i--) 
 	{
-		Frame f = Frames[i];
+		// Only the columns we compare get touched until we find the frame
+		int deltaMs = Frames.getDeltaMs(i);
 		if (useElapsed)
 		{
-			if (f.elapsedTime > ms)
+			int elapsedTime = Frames.getElapsedTime(i);
+			if (elapsedTime > ms)
 			{
-				double ratio = (float)((f.deltaMs - (f.elapsedTime - ms))) / (float)f.deltaMs;
+				double ratio = (float)((deltaMs - (elapsedTime - ms))) / (float)deltaMs;
+				Frame* f = new Frame();
+				interpolateFrame(Frames.get(i + 1), Frames.get(i), ratio, ms, f);
 				DebugPop("Leaving RewindManager::getFrameAtMs");
-				return new Frame(interpolateFrame(Frames[i + 1], f, ratio, ms));
+				return f;
 			}
 		}
 		else
 		{
-			if (f.ms > ms)
+			int frameMs = Frames.getMs(i);
+			if (frameMs > ms)
 			{
-				double ratio = (float)((f.deltaMs - (f.ms - ms))) / (float)f.deltaMs;
+				double ratio = (float)((deltaMs - (frameMs - ms))) / (float)deltaMs;
 				currentIndex = i;
 				streamTimePosition = ms;
+				Frame* f = new Frame();
+				interpolateFrame(Frames.get(i + 1), Frames.get(i), ratio, ms, f);
 				DebugPop("Leaving RewindManager::getFrameAtMs");
-				return new Frame(interpolateFrame(Frames[i + 1], f, ratio, ms));
+				return f;
 			}
 		}
 	}
@@ -1295,117 +1097,82 @@ Frame* RewindManager::getFrameAtMs(float ms,int index = -1,bool useElapsed)
 
 }
 
-Frame* RewindManager::getNextRewindFrame(float delta)
+bool RewindManager::getNextRewindFrame(float delta, Frame* out)
 {
 	DebugPush("Entering RewindManager::getNextRewindFrame(%f)", delta);
+	materialize();
 	if (delta < 0)
 	{
 		DebugPop("Leaving RewindManager::getNextRewindFrame");
-		return NULL;
+		return false;
 	}
 
 	if (Frames.size() == 0)
 	{
 		DebugPop("Leaving RewindManager::getNextRewindFrame");
-		return NULL;
+		return false;
 	}
 
 	if (Frames.size() >= 2)
 	{
-		if (delta < Frames.back().deltaMs)
+		Frame& first = this->cursorOne;
+		Frame& second = this->cursorTwo;
+		Frames.get(Frames.size() - 1, &first);
+		if (delta < first.deltaMs)
 		{
-			Frame first = Frames.back();
-			Frame second = Frames[Frames.size() - 2];
-			Frames.pop_back();
-
-			Frame interpolated = interpolateFrame(first, second, ((float)delta) / ((float)first.deltaMs), delta);
+			Frames.get(Frames.size() - 2, &second);
+			popLastFrame();
 
-			Frames.push_back(interpolated);
-
-			DebugPop("Leaving RewindManager::getNextRewindFrame");
-			return new Frame(interpolated);
+			interpolateFrame(first, second, ((float)delta) / ((float)first.deltaMs), delta, out);
 		}
 		else
 		{
-			Frame first = Frames.back();
-
+			// Count the frames delta goes past first, only the last of them ever gets looked at
+			int count = Frames.size();
+			int popped = 0;
 			int deltaAccumulator = 0;
-			Frame midframe = Frames.back();
-
-			bool outOfFrames = 0;
-
-			while (deltaAccumulator < delta)
-			{
-				if (Frames.size() == 0)
-				{
-					outOfFrames = 1;
-					break;
-				}
-				midframe = Frames.back();
-				Frames.pop_back();
-				deltaAccumulator += midframe.deltaMs;
-			}
-			if (!outOfFrames)
-			{
-				//Frames.pop_back();
+			while (deltaAccumulator < delta && popped < count)
+				deltaAccumulator += Frames.getDeltaMs(count - 1 - popped++);
+			bool outOfFrames = deltaAccumulator < delta;
 
-				Frame lastframe = Frames.size() == 0 ? midframe : Frames.back();
-
-				Frame interpolated = interpolateFrame(first, lastframe, ((float)delta) / ((float)deltaAccumulator), deltaAccumulator - delta);
-
-				Frames.push_back(interpolated);
-				DebugPop("Leaving RewindManager::getNextRewindFrame");
-				return new Frame(interpolated);
-			}
+			int midframe = popped == 0 ? count - 1 : count - popped;
+			if (!outOfFrames && count - popped > 0)
+				Frames.get(count - popped - 1, &second);
 			else
-			{
-				Frame interpolated = interpolateFrame(first, midframe, ((float)delta) / ((float)deltaAccumulator), deltaAccumulator - delta);
+				Frames.get(midframe, &second);
 
-				Frames.push_back(interpolated);
-				DebugPop("Leaving RewindManager::getNextRewindFrame");
-				return new Frame(interpolated);
-			}
+			for (int i = 0; i < popped; i++)
+				popLastFrame();
 
+			interpolateFrame(first, second, ((float)delta) / ((float)deltaAccumulator), deltaAccumulator - delta, out);
 		}
+		Frames.push(*out);
 	}
 	else
 	{
-		Frame ret = Frames.back();
-		Frames.pop_back();
-		DebugPop("Leaving RewindManager::getNextRewindFrame");
-		return new Frame(ret);
+		Frames.get(0, out);
+		popLastFrame();
 	}
 	DebugPop("Leaving RewindManager::getNextRewindFrame");
+	return true;
 }
 
-Frame* RewindManager::getNextFrame(float delta)
+bool RewindManager::getNextFrame(float delta, Frame* out)
 {
 	DebugPush("Entering RewindManager::getNextFrame(%f)", delta);
 	streamTimePosition += delta;
 
 	if (streamTimePosition < 0) streamTimePosition = 0;
 
-	int timepos = streamTimePosition;
-
-	Frame* testF = getFrameAtElapsedMs(streamTimePosition); 
-
-	if (testF == NULL)
-	{
-		DebugPop("Leaving RewindManager::getNextFrame");
-		return NULL;
-	}
-
-	Frame* f = new Frame(*testF);
-
-	deleteSafe(testF);
-	
+	bool found = getFrameAtElapsedMs(streamTimePosition, out);
 	DebugPop("Leaving RewindManager::getNextFrame");
-	return f;
+	return found;
 }
 
 Frame* RewindManager::getNextNonElapsedFrame(float delta)
 {
 	DebugPush("Entering RewindManager::getNextNonElpasedFrame(%f)", delta);
+	materialize();
 	streamTimePosition += delta;
 
 	if (streamTimePosition < 0) streamTimePosition = 0;
@@ -1433,7 +1200,7 @@ Frame* RewindManager::getNextNonElapsedFrame(float delta)
 
 	for (int i = currentIndex; i >= 0; i--)
 	{
-		if (Frames[i].ms < streamTimePosition)
+		if (Frames.getMs(i) < streamTimePosition)
 		{
 			currentIndex--;
 		}
@@ -1463,14 +1230,16 @@ void RewindManager::clearSaveStates()
 void RewindManager::saveState(Worker* worker)
 {
 	DebugPush("Entering RewindManager::saveState");
+	materialize();
 	SaveStates.push_back(Frames);
 	if (worker != NULL)
 	{
 		RewindManager* copy = new RewindManager(*this);
+		ReplayCodec codec = getPreferredCodec();
 		worker->addTask([=]() {
-			std::string frameTime = std::to_string(Frames.back().ms);
+			std::string frameTime = std::to_string(Frames.getMs(Frames.size() - 1));
 			std::string filePath = replayPath.substr(0, replayPath.find_last_of('.')) + frameTime + "-" + std::to_string(SaveStates.size()) + ".rwx";
-			copy->save(filePath);
+			copy->save(filePath, codec);
 			deleteSafe(copy);
 			// DebugPop("Leaving RewindManager::clear");
 			});
@@ -1481,6 +1250,8 @@ void RewindManager::saveState(Worker* worker)
 void RewindManager::loadState(int index)
 {
 	DebugPush("Entering RewindManager::loadState");
+	closeReader();
+	unrecordAll();
 	Frames = SaveStates[index];
 	DebugPop("Leaving RewindManager::loadState");
 }
@@ -1488,18 +1259,34 @@ void RewindManager::loadState(int index)
 void RewindManager::spliceReplayFromMs(float ms)
 {
 	DebugPush("Entering RewindManager::spliceReplayFromMs");
-	std::vector<Frame> newFrames;
-	Frame* atMs = this->getFrameAtElapsedMs(ms);
-	for (auto& frame : Frames)
+	Frame atMs;
+	bool found = this->getFrameAtElapsedMs(ms, &atMs);
+	if (this->reader != NULL)
 	{
-		if (frame.elapsedTime < ms)
-			newFrames.push_back(frame);
-		else
-			break;
+		// Only uncompress the part of the replay we're keeping
+		unrecordAll();
+		Frames.clear();
+		Frame frame;
+		for (int i = 0; this->reader->getFrame(i, &frame); i++)
+		{
+			if (frame.elapsedTime < ms)
+				Frames.push(frame);
+			else
+				break;
+		}
+		closeReader();
+	}
+	else
+	{
+		int count = 0;
+		while (count < Frames.size() && Frames.getElapsedTime(count) < ms)
+			count++;
+		unrecordFrom(count);
+		Frames.truncate(count);
 	}
-	if (atMs != NULL)
-		newFrames.push_back(*atMs);
-	deleteSafe(atMs);
-	Frames = newFrames;
+	if (found)
+		Frames.push(atMs);
+	// The player carries on from here, what's left of the replay becomes the start of a new run
+	this->recording = true;
 	DebugPop("Leaving RewindManager::spliceReplayFromMs");
 }
\ No newline at end of file
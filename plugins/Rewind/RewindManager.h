@@ -1,28 +1,67 @@
 #pragma once
 #include <vector>
 #include "frame.h"
+#include "FrameStore.h"
 #include "RewindApi.h"
 #include <thread>
 #include "WorkerThread.h"
 #include <assert.h>
 #include "Logging.h"
+#include "ReplayFile.h"
+#include "RecordCursor.h"
 
-struct ReplayInfo
+class ReplayRecorder;
+
+// What loading a replay had to say, kept until it's back on the main thread where the console can print it
+struct ReplayLoadLog
 {
-	int version;
-	int time;
-	int elapsedTime;
-	int frameCount;
-	std::string replayPath;
-	std::string replayMission;
+	std::vector<std::pair<bool, std::string>> messages; // true for errors
+
+	void add(bool error, std::string message);
+	// Main thread only
+	void print() const;
 };
 
 class RewindManager
 {
-	std::vector<Frame> Frames;
-	std::vector<std::vector<Frame>> SaveStates;
+	FrameStore Frames;
+	std::vector<FrameStore> SaveStates;
 	std::mutex mutex;
 
+	ReplayReader* reader = NULL; // Set while a replay is being streamed from disk instead of sitting in Frames
+
+	// The run being played gets encoded on the recorder's thread as it goes, clear(true) only has to tell it to write the file
+	ReplayRecorder* recorder = NULL;
+	RecordCursor recordCursor;
+	bool recording = true; // False while Frames holds a replay that was loaded, pushFrame only records a live run
+
+	// Where the last playback lookup ended up, playback only moves a little every tick so the next one walks from there
+	int cursorIndex = 0;
+	Frame cursorOne; // Scratch frames for interpolating, they keep their capacity between lookups and rewind steps
+	Frame cursorTwo;
+
+	std::string loadChunked(FILE* f, bool isGhost, ReplayLoadLog* log);
+	void materialize();
+	void closeReader();
+	// Drops or thins the oldest frames once $pref::Rewind::MaxMemoryMB / MaxSeconds is exceeded
+	void enforceHistoryBudget();
+	// Drops the second to last frame if interpolating its neighbours reproduces it within $pref::Rewind::ThinTolerance
+	void thinLastFrame();
+	// Hands Frames[recordCursor.recorded, count) to the recorder
+	void recordFrames(int count);
+	// Takes back every recorded frame from index onwards, call whenever those frames get removed or replaced
+	void unrecordFrom(int index);
+	// Takes back the whole run, frames the history budget dropped included. Only for when Frames gets replaced
+	void unrecordAll();
+	void popLastFrame();
+	int getFrameKey(int index, bool useElapsed);
+	// False if a streamed replay is broken at index, it ends before there from then on
+	bool getFrameInto(int index, Frame* out);
+	// Moves the cursor to the last frame whose key is <= key (or the first frame) and returns its index
+	int seekCursor(float key, bool useElapsed);
+	// Interpolates the frame at key into out, false if key lies past the last frame
+	bool getFrameAtKey(float key, bool useElapsed, Frame* out);
+
 public:
 	std::string replayPath = std::string(".\\marble\\client\\replays\\testReplay.rwx");
 	std::string replayMission = std::string("none");
@@ -47,32 +86,51 @@ public:
 	~RewindManager();
 	void pushFrame(Frame f);
 	Frame popFrame(bool peek);
-	Frame getFrameAt(int index);
+	// False once a streamed replay turns out to be broken at index
+	bool getFrameAt(int index, Frame* out);
 	int getFrameCount();
-	void save(std::string path);
+	void save(std::string path, ReplayCodec codec);
 	std::string load(std::string path,bool isGhost = false);
-	ReplayInfo analyze(std::string path);
-	void clear(bool write, Worker* worker);
-	Frame interpolateFrame(Frame one, Frame two, float ratio, float delta);
+	// load without the console or debug log, safe on any thread. Messages end up in log for the main thread to print, bindings are left unresolved
+	std::string loadReplayFile(std::string path, bool isGhost, ReplayLoadLog* log);
+	// Decodes a streamed replay into memory, lets loadReplayFile run off the main thread with nothing left to read from disk later. Doesn't log either
+	void decodeReplay();
+	// Swaps in the replay other loaded and leaves other empty, main thread only
+	void takeReplay(RewindManager* other);
+	// Only reads the file, safe to call from any thread
+	static ReplayInfo analyze(std::string path);
+	// Points the rewindable states of every frame back at their binding, call after loading and whenever rewindableBindings changes
+	void resolveRewindableBindings();
+	void clear(bool write);
+	// Overwrites every field of out, whose buffers get reused. out can't be one or two
+	void interpolateFrame(const Frame& one, const Frame& two, float ratio, float delta, Frame* out);
+	template<typename T>
+	void InterpolateRewindableState(const RewindableState<T>& one, const RewindableState<T>& two, float ratio, float delta, RewindableState<T>* out);
 	template<typename T>
-	RewindableState<T> InterpolateRewindableState(RewindableState<T> one, RewindableState<T> two, float ratio, float delta);
+	void InterpolateRewindableStates(const std::vector<RewindableState<T>>& one, const std::vector<RewindableState<T>>& two, float ratio, float delta, std::vector<RewindableState<T>>* out);
 	Frame* getFrameAtMs(float ms,int index,bool useElapsed = true);
-	Frame* getFrameAtElapsedMs(float ms);
-	Frame* getNextFrame(float delta);
-	Frame* getNextRewindFrame(float delta);
+	// Playback lookups, out is owned by the caller and can be reused across ticks. False once ms is past the end
+	bool getFrameAtElapsedMs(float ms, Frame* out);
+	bool getNextFrame(float delta, Frame* out);
+	// Steps the rewind back by delta, the frame it lands on replaces the ones it went past. False once there's nothing to rewind
+	bool getNextRewindFrame(float delta, Frame* out);
 	Frame* getNextNonElapsedFrame(float delta);
-	Frame* getRealtimeFrameAtMs(float ms);
+	// Clamps to the last frame instead, false only without frames
+	bool getRealtimeFrameAtMs(float ms, Frame* out);
 	int getSavedStateCount();
 	void saveState(Worker* worker);
 	void loadState(int saveStateIndex);
 	void clearSaveStates();
 	void spliceReplayFromMs(float ms);
+	// Lets the recorder finish writing and stops its thread
+	void stopRecording();
 
 	inline bool hasMs(int ms)
 	{
-		for (auto& it : Frames)
+		materialize();
+		for (int i = 0; i < Frames.size(); i++)
 		{
-			if (it.ms == ms)
+			if (Frames.getMs(i) == ms)
 				return true;
 		}
 		return false;
@@ -83,24 +141,25 @@ public:
 		currentIndex = Frames.size() - 1;
 		streamTimePosition = 0;
 		averageDelta = 0;
-		for (auto& frame : Frames)
-			averageDelta += frame.deltaMs;
+		for (int i = 0; i < Frames.size(); i++)
+			averageDelta += Frames.getDeltaMs(i);
 
 		averageDelta /= Frames.size();
 	}
 
 	inline Frame getFrameAtIndex()
 	{
-		return Frames[currentIndex];
+		return Frames.get(currentIndex);
 	}
 	inline void setFrameElapsedTimes()
 	{
 		if (totalTime == 0)
 		{
-			for (int i = Frames.size() - 1; i >= 0; i--)
+			// Frames are oldest first so the elapsed time accumulates in order
+			for (int i = 0; i < Frames.size(); i++)
 			{
-				totalTime += Frames[i].deltaMs;
-				Frames[i].elapsedTime = totalTime;
+				totalTime += Frames.getDeltaMs(i);
+				Frames.setElapsedTime(i, totalTime);
 			}
 		}
 	}
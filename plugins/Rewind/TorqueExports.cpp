@@ -14,6 +14,13 @@
 #include "WorkerThread.h"
 #include "Logging.h"
 #include "Dispatcher.h"
+#include "ReplayFile.h"
+#include "ReplayIndex.h"
+#include "LerpSpan.h"
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
 #ifdef __APPLE__
 #include <sys/stat.h>
 #include <unistd.h>
@@ -34,8 +41,13 @@ std::vector<TGE::TSShapeInstance*> trapdoorShapeInstances;
 
 Frame previousGhostFrame;
 Frame previousFrame;
+// Rewinding, replay and ghost playback interpolate into these every tick, they keep their capacity so playback doesn't allocate
+Frame rewindScratchFrame;
+Frame playbackFrame;
+Frame ghostPlaybackFrame;
 
 Worker workerThread;
+ThreadPool threadPool;
 
 bool physicsOn = true;
 
@@ -111,9 +123,69 @@ ConsoleFunction(registerRewindable, void, 4, 4, "registerRewindable(string names
 		rewindManager.rewindableBindings.push_back(new RewindableBinding<std::string>(binding));
 		ghostReplayManager.rewindableBindings.push_back(new RewindableBinding<std::string>(binding));
 	}
+	// States recorded or loaded before the binding existed can be interpolated now
+	rewindManager.resolveRewindableBindings();
+	ghostReplayManager.resolveRewindableBindings();
 	DebugPop("Leaving registerRewindable()");
 }
 
+// Same as registerRewindable with a Variable binding, except the variable is read, written and interpolated natively instead of calling into script
+ConsoleFunction(registerRewindableVariable, void, 4, 4, "registerRewindableVariable(string variable,int storagetype,int interpMode)")
+{
+	int storagetype = atoi(argv[2]);
+	int interpMode = atoi(argv[3]);
+
+	DebugPush("Entering registerRewindableVariable(%s,%s,%s)", argv[1], argv[2], argv[3]);
+
+	// Checked before anything gets created, an unknown interp mode would otherwise silently lerp like InterpLinear
+	if (storagetype < 0 || storagetype > 3)
+	{
+		TGE::Con::errorf("registerRewindableVariable: invalid storage type %d", storagetype);
+		DebugPop("Leaving registerRewindableVariable()");
+		return;
+	}
+	if (interpMode != InterpLinear && interpMode != InterpStep && interpMode != InterpAngleWrap)
+	{
+		TGE::Con::errorf("registerRewindableVariable: invalid interp mode %d", interpMode);
+		DebugPop("Leaving registerRewindableVariable()");
+		return;
+	}
+
+	RewindableBindingBase* binding = NULL;
+	RewindableBindingBase* ghostBinding = NULL;
+	if (storagetype == 0)
+	{
+		binding = new RewindableBinding<int>(Variable, std::string(argv[1]));
+		ghostBinding = new RewindableBinding<int>(Variable, std::string(argv[1]));
+	}
+	else if (storagetype == 1)
+	{
+		binding = new RewindableBinding<float>(Variable, std::string(argv[1]));
+		ghostBinding = new RewindableBinding<float>(Variable, std::string(argv[1]));
+	}
+	else if (storagetype == 2)
+	{
+		binding = new RewindableBinding<bool>(Variable, std::string(argv[1]));
+		ghostBinding = new RewindableBinding<bool>(Variable, std::string(argv[1]));
+	}
+	else
+	{
+		binding = new RewindableBinding<std::string>(Variable, std::string(argv[1]));
+		ghostBinding = new RewindableBinding<std::string>(Variable, std::string(argv[1]));
+	}
+
+	binding->Native = true;
+	binding->InterpMode = (RewindableInterpMode)interpMode;
+	ghostBinding->Native = true;
+	ghostBinding->InterpMode = (RewindableInterpMode)interpMode;
+	rewindManager.rewindableBindings.push_back(binding);
+	ghostReplayManager.rewindableBindings.push_back(ghostBinding);
+
+	rewindManager.resolveRewindableBindings();
+	ghostReplayManager.resolveRewindableBindings();
+	DebugPop("Leaving registerRewindableVariable()");
+}
+
 ConsoleFunction(unregisterRewindable, void, 2, 2, "unregisterRewindable(string namespace)")
 {
 	DebugPush("Entering unregisterRewindable(%s)", argv[1]);
@@ -133,6 +205,9 @@ ConsoleFunction(unregisterRewindable, void, 2, 2, "unregisterRewindable(string n
 					RewindableBindingBase* base2 = *(ghostReplayManager.rewindableBindings.begin() + i);
 					ghostReplayManager.rewindableBindings.erase(ghostReplayManager.rewindableBindings.begin() + i);
 					deleteSafe(base2);
+					// Every binding after it moved down by one
+					rewindManager.resolveRewindableBindings();
+					ghostReplayManager.resolveRewindableBindings();
 					DebugPop("Leaving unregisterRewindable()");
 					return;
 				}
@@ -141,6 +216,8 @@ ConsoleFunction(unregisterRewindable, void, 2, 2, "unregisterRewindable(string n
 		}
 	}
 
+	rewindManager.resolveRewindableBindings();
+	ghostReplayManager.resolveRewindableBindings();
 	DebugPop("Leaving unregisterRewindable()");
 }
 
@@ -261,18 +338,48 @@ ConsoleFunction(loadReplay,const char *, 2, 3, "loadReplay(string path,bool ghos
 	return retbuff;
 }
 
+ConsoleFunction(loadReplayAsync, void, 4, 4, "loadReplayAsync(string path, bool ghostreplay, function onReplayLoaded(string mission))")
+{
+	TGE::Con::printf("Loading replay %s", argv[1]);
+	char buf[512];
+	TGE::Con::expandScriptFilename(buf, 512, argv[1]);
+	std::string path = std::string(buf);
+	bool isGhost = atoi(argv[2]) == 1;
+	std::string callback = std::string(argv[3]);
+
+	// Loaded into a manager of its own so the game can keep using the current replay until the new one is ready
+	RewindManager* target = isGhost ? &ghostReplayManager : &rewindManager;
+	RewindManager* loaded = new RewindManager();
+	loaded->pathedInteriors = NULL;
+	loaded->game = target->game;
+
+	// The worker only reads, the console and the debug log wait for the main thread
+	workerThread.addTask([=]() {
+		ReplayLoadLog log;
+		std::string mission = loaded->loadReplayFile(path, isGhost, &log);
+		loaded->decodeReplay();
+		dispatcher.run([=]() {
+			log.print();
+			target->takeReplay(loaded);
+			delete loaded;
+			TGE::Con::executef(2, callback.c_str(), mission.c_str());
+		});
+	});
+}
+
 ConsoleFunction(getAverageFrameDelta, F32, 1, 1, "getAverageFrameDelta()")
 {
 	F32 avg = 0;
-	for (int i = 0; i < rewindManager.getFrameCount(); i++)
-		avg += rewindManager.getFrameAt(i).deltaMs;
+	Frame frame;
+	for (int i = 0; i < rewindManager.getFrameCount() && rewindManager.getFrameAt(i, &frame); i++)
+		avg += frame.deltaMs;
 
 	return avg / rewindManager.getFrameCount();
 }
 
 ConsoleFunction(clearFrames, void, 1, 2, "clearFrames(bool write)")
 {
-	rewindManager.clear(atoi(argv[1]), &workerThread);
+	rewindManager.clear(atoi(argv[1]));
 }
 
 ConsoleFunction(rewindFrame_internal, bool, 1, 2, "rewindFrame_internal(delta)")
@@ -280,9 +387,8 @@ ConsoleFunction(rewindFrame_internal, bool, 1, 2, "rewindFrame_internal(delta)")
 	Frame* f = NULL;
 	if (argc == 2)
 	{
-		if (rewindManager.getFrameCount() == 0) f = NULL;
-		if (rewindManager.streamTimePosition + (atof(argv[1])) < 0) f = NULL;
-		f = rewindManager.getNextFrame(atof(argv[1]));
+		if (rewindManager.getNextFrame(atof(argv[1]), &playbackFrame))
+			f = &playbackFrame;
 		replayTimeDelta = atof(argv[1]);
 	}
 
@@ -296,26 +402,19 @@ ConsoleFunction(rewindFrame_internal, bool, 1, 2, "rewindFrame_internal(delta)")
 
 ConsoleFunction(rewindToMs, bool, 2, 2, "rewindToMs(ms)")
 {
-	Frame* f = NULL;
-	if (rewindManager.getFrameCount() == 0)
-		f = NULL;
-	f = rewindManager.getFrameAtElapsedMs(atof(argv[1]));
-
-	if (f == NULL)
+	if (!rewindManager.getFrameAtElapsedMs(atof(argv[1]), &playbackFrame))
 		return false;
 
-	RewindFrame(f);
-
-	deleteSafe(f);
-
+	RewindFrame(&playbackFrame);
 	return true;
 }
 
 ConsoleFunction(rewindGhost_internal, void, 2, 2, "rewindGhost_internal(delta)")
 {
-	Frame* f = ghostReplayManager.getRealtimeFrameAtMs(atof(argv[1]));
-	RewindGhost(f);
-	deleteSafe(f);
+	if (ghostReplayManager.getRealtimeFrameAtMs(atof(argv[1]), &ghostPlaybackFrame))
+		RewindGhost(&ghostPlaybackFrame);
+	else
+		RewindGhost(NULL);
 }
 
 ConsoleFunction(storeFrame, void, 2, 2, "storeFrame(ms)")
@@ -356,7 +455,7 @@ ConsoleFunction(analyzeReplay, void, 3, 3, "analyzeReplay(string path, function
 
 		ReplayInfo info = rewindManager.analyze(path);
 
-		sprintf(buf, "$ReplayAnalysisReturn = new ScriptObject(ReplayAnalysis) { version = %d; framecount = %d; time = %d; elapsedtime = %d; replaymission = \"%s\"; };", info.version, info.frameCount, info.time, info.elapsedTime, info.replayMission.c_str());
+		sprintf(buf, "$ReplayAnalysisReturn = new ScriptObject(ReplayAnalysis) { version = %d; framecount = %d; time = %d; elapsedtime = %d; replaymission = \"%s\"; replaygame = \"%s\"; checksum = \"%08x\"; };", info.version, info.frameCount, info.time, info.elapsedTime, info.replayMission.c_str(), info.replayGame.c_str(), info.checksum);
 
 		std::string exec = std::string(buf);
 		dispatcher.run([=]() { TGE::Con::evaluatef(exec.c_str()); });
@@ -368,11 +467,329 @@ ConsoleFunction(analyzeReplay, void, 3, 3, "analyzeReplay(string path, function
 	});
 }
 
+// Quotes str as a TorqueScript string literal
+static std::string scriptString(const std::string& str)
+{
+	std::string out = "\"";
+	for (char c : str)
+	{
+		if (c == '"' || c == '\\')
+			out += '\\';
+		out += c;
+	}
+	return out + "\"";
+}
+
+// $ReplayAnalysisList gets a SimGroup with a ReplayAnalysis ScriptObject per replay and callback is called with it, all in one go
+static std::string getReplayListScript(const std::vector<ReplayIndexEntry>& entries, const std::string& callback)
+{
+	std::string script = "$ReplayAnalysisList = new SimGroup() {\n";
+	char line[256];
+	for (auto& entry : entries)
+	{
+		if (!entry.valid)
+			continue;
+		const ReplayInfo& info = entry.info;
+		script += "new ScriptObject(ReplayAnalysis) { path = " + scriptString(info.replayPath) + ";";
+		sprintf(line, " version = %d; framecount = %d; time = %d; elapsedtime = %d; checksum = \"%08x\";", info.version, info.frameCount, info.time, info.elapsedTime, info.checksum);
+		script += line;
+		script += " replaymission = " + scriptString(info.replayMission) + "; replaygame = " + scriptString(info.replayGame) + "; };\n";
+	}
+	return script + "};\n" + callback + "($ReplayAnalysisList);";
+}
+
+ConsoleFunction(analyzeReplayDirectory, void, 3, 3, "analyzeReplayDirectory(string path, function onReplaysAnalyzed(SimGroup))")
+{
+	char buf[512];
+	TGE::Con::expandScriptFilename(buf, 512, argv[1]);
+	std::string path = std::string(buf);
+	std::string callback = std::string(argv[2]);
+
+	workerThread.addTask([=]() {
+		std::string script = getReplayListScript(scanReplayDirectory(path, &threadPool), callback);
+		dispatcher.run([=]() { TGE::Con::evaluate(script.c_str(), false, NULL); });
+	});
+}
+
+// Straight out of index.bin, which saving and analyzing keep up to date. analyzeReplayDirectory catches replays that changed behind our back
+ConsoleFunction(listReplays, void, 3, 3, "listReplays(string path, function onReplaysListed(SimGroup))")
+{
+	char buf[512];
+	TGE::Con::expandScriptFilename(buf, 512, argv[1]);
+	std::string path = std::string(buf);
+	std::string callback = std::string(argv[2]);
+
+	workerThread.addTask([=]() {
+		std::string script = getReplayListScript(readReplayIndex(path), callback);
+		dispatcher.run([=]() { TGE::Con::evaluate(script.c_str(), false, NULL); });
+	});
+}
+
+ConsoleFunction(recoverReplay, bool, 3, 3, "recoverReplay(string partialPath, string path)")
+{
+	char partialPath[512];
+	char path[512];
+	TGE::Con::expandScriptFilename(partialPath, 512, argv[1]);
+	TGE::Con::expandScriptFilename(path, 512, argv[2]);
+	if (!recoverReplay(std::string(partialPath), std::string(path)))
+	{
+		TGE::Con::errorf("Could not recover replay %s", partialPath);
+		return false;
+	}
+	updateReplayIndex(path);
+	TGE::Con::printf("Recovered replay %s", path);
+	return true;
+}
+
 ConsoleFunction(spliceReplay, void, 2, 2, "spliceReplay(float ms)")
 {
 	rewindManager.spliceReplayFromMs(atof(argv[1]));
 }
 
+// A marble rolling around a level with a few moving platforms and some gems picked up along the way
+static Frame makeBenchmarkFrame(int index)
+{
+	Frame frame;
+	float t = index * 0.016f;
+	frame.ms = index * 16;
+	frame.deltaMs = 16;
+	frame.position = Point3D(cosf(t) * 20, sinf(t * 0.7f) * 20, sinf(t * 3) * 0.5f);
+	frame.velocity = Point3D(-sinf(t) * 20, cosf(t * 0.7f) * 14, cosf(t * 3) * 1.5f);
+	frame.spin = Point3D(cosf(t * 0.7f) * 14, sinf(t) * 20, 0);
+	frame.powerup = (index / 300) % 4;
+	frame.timebonus = 0;
+	frame.gemcount = index / 200;
+	for (int i = 0; i < 4; i++)
+	{
+		MPState state;
+		state.pathPosition = fmodf(index * 16.0f + i * 1000, 8000);
+		state.targetPosition = -1;
+		state.pathedInterior = NULL;
+		frame.mpstates.push_back(state);
+	}
+	for (int i = 0; i < 30; i++)
+		frame.gemstates.push_back(i < frame.gemcount);
+	frame.powerupstates = std::vector<int>(8, 0);
+	frame.gamestate = "Go";
+	frame.nextstatetime = 0;
+	frame.activepowstates = std::vector<int>(3, 0);
+	frame.gravityDir = "1 0 0 0 -1 0 0 0 -1";
+	return frame;
+}
+
+ConsoleFunction(benchmarkReplayCodecs, void, 1, 2, "benchmarkReplayCodecs(int frames = 20000)")
+{
+	int frameCount = argc > 1 ? atoi(argv[1]) : 20000;
+	const int passes = 5;
+
+	// Encode the frames into chunks exactly like ReplayWriter does, so only the compression is measured
+	std::vector<std::vector<uint8_t>> chunks;
+	size_t totalSize = 0;
+	MemoryStream chunk;
+	Frame previous;
+	for (int i = 0; i < frameCount; i++)
+	{
+		Frame frame = makeBenchmarkFrame(i);
+		writeFrame(frame, &chunk, i % REPLAY_CHUNK_FRAMES == 0 ? NULL : &previous);
+		previous = frame;
+		if (i % REPLAY_CHUNK_FRAMES == REPLAY_CHUNK_FRAMES - 1 || i == frameCount - 1)
+		{
+			chunks.push_back(std::vector<uint8_t>(chunk.getBuffer(), chunk.getBuffer() + chunk.length()));
+			totalSize += chunk.length();
+			chunk.clear();
+		}
+	}
+	TGE::Con::printf("Replay codecs on %d frames, %d chunks, %u bytes encoded", frameCount, (int)chunks.size(), (unsigned)totalSize);
+
+	const char* names[] = { "raw", "lz", "zlib1", "zlib", "zlib9" };
+	std::vector<uint8_t> uncompressed;
+	for (const char* name : names)
+	{
+		ReplayCodec codec = parseReplayCodec(name);
+		std::vector<std::vector<uint8_t>> outputs(chunks.size());
+		std::vector<uint8_t> usedCodecs(chunks.size());
+		size_t compressedSize = 0;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int pass = 0; pass < passes; pass++)
+		{
+			compressedSize = 0;
+			for (size_t i = 0; i < chunks.size(); i++)
+			{
+				outputs[i].resize(replayCompressBound(codec, chunks[i].size()));
+				outputs[i].resize(replayCompress(codec, chunks[i].data(), chunks[i].size(), outputs[i].data(), &usedCodecs[i]));
+				compressedSize += outputs[i].size();
+			}
+		}
+		auto middle = std::chrono::high_resolution_clock::now();
+		bool ok = true;
+		for (int pass = 0; pass < passes; pass++)
+		{
+			for (size_t i = 0; i < chunks.size(); i++)
+			{
+				uncompressed.resize(chunks[i].size());
+				ok &= replayUncompress(usedCodecs[i], outputs[i].data(), outputs[i].size(), uncompressed.data(), uncompressed.size());
+			}
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+
+		double megabytes = (double)totalSize * passes / (1024 * 1024);
+		double compressSeconds = std::chrono::duration<double>(middle - start).count();
+		double uncompressSeconds = std::chrono::duration<double>(end - middle).count();
+		TGE::Con::printf("%-6s ratio %.2f, compress %.1f MB/s, uncompress %.1f MB/s%s", name, (double)totalSize / compressedSize,
+			megabytes / compressSeconds, megabytes / uncompressSeconds, ok ? "" : " (FAILED)");
+	}
+}
+
+// Total capacity of every buffer in the frame, it changes whenever one of them grows. This doesn't see allocations that
+// leave the capacity the same or happen outside the frame, so it's reported as buffer growth rather than an allocation count
+static size_t getFrameCapacity(const Frame& frame)
+{
+	size_t capacity = frame.mpstates.capacity() + frame.gemstates.capacity() + frame.ttstates.capacity() + frame.powerupstates.capacity()
+		+ frame.gamestate.capacity() + frame.lmstates.capacity() + frame.activepowstates.capacity() + frame.gravityDir.capacity()
+		+ frame.trapdoordirs.capacity() + frame.trapdooropen.capacity() + frame.trapdoorclose.capacity() + frame.trapdoorpos.capacity()
+		+ frame.rewindableIntStates.capacity() + frame.rewindableFloatStates.capacity() + frame.rewindableBoolStates.capacity() + frame.rewindableStringStates.capacity()
+		+ frame.rewindableSOIntStates.capacity() + frame.rewindableSOFloatStates.capacity() + frame.rewindableSOBoolStates.capacity() + frame.rewindableSOStringStates.capacity();
+#ifdef MBP
+	capacity += frame.teleportState.destination.capacity() + frame.checkpointState.Obj.capacity() + frame.checkpointState.gemStates.capacity()
+		+ frame.checkpointState.gravity.capacity() + frame.checkpointState.respawnOffset.capacity();
+#endif
+	return capacity;
+}
+
+ConsoleFunction(benchmarkInterpolation, void, 1, 2, "benchmarkInterpolation(int frames = 20000)")
+{
+	int frameCount = argc > 1 ? atoi(argv[1]) : 20000;
+	const int passes = 5;
+
+	// No bindings and no pathed interiors, this measures interpolateFrame itself rather than script callbacks
+	RewindManager manager;
+	manager.pathedInteriors = NULL;
+	std::vector<Frame> frames;
+	for (int i = 0; i <= frameCount; i++)
+		frames.push_back(makeBenchmarkFrame(i));
+
+	// What every lookup used to do, a new Frame with all of its buffers allocated from scratch
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int pass = 0; pass < passes; pass++)
+	{
+		for (int i = 0; i < frameCount; i++)
+		{
+			Frame fresh;
+			manager.interpolateFrame(frames[i], frames[i + 1], 0.5f, 8, &fresh);
+		}
+	}
+	auto middle = std::chrono::high_resolution_clock::now();
+
+	// One scratch frame reused throughout, its buffers only grow during the first interpolation
+	Frame scratch;
+	manager.interpolateFrame(frames[0], frames[1], 0.5f, 8, &scratch);
+	size_t capacity = getFrameCapacity(scratch);
+	int grown = 0;
+	for (int pass = 0; pass < passes; pass++)
+	{
+		for (int i = 0; i < frameCount; i++)
+		{
+			manager.interpolateFrame(frames[i], frames[i + 1], 0.5f, 8, &scratch);
+			if (getFrameCapacity(scratch) != capacity)
+			{
+				capacity = getFrameCapacity(scratch);
+				grown++;
+			}
+		}
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+
+	double interpolations = (double)frameCount * passes;
+	TGE::Con::printf("interpolateFrame on %d frames: new frame %.0f ns/frame, scratch frame %.0f ns/frame, %d of %.0f scratch interpolations grew a buffer",
+		frameCount, std::chrono::duration<double, std::nano>(middle - start).count() / interpolations,
+		std::chrono::duration<double, std::nano>(end - middle).count() / interpolations, grown, interpolations);
+}
+
+ConsoleFunction(benchmarkLerpSpan, void, 1, 2, "benchmarkLerpSpan(int elements = 10000000)")
+{
+	int total = argc > 1 ? atoi(argv[1]) : 10000000;
+	// Frame lists are short, the per call overhead matters as much as the throughput
+	const int lengths[] = { 8, 64, 1024 };
+	LerpSpanKernel best = getLerpSpanKernel();
+	TGE::Con::printf("lerpSpan on %d elements per run, %s kernel picked for this CPU", total, getLerpSpanKernelName(best));
+
+	volatile float sink = 0;
+	for (int length : lengths)
+	{
+		std::vector<float> floatsOne(length), floatsTwo(length), floatsOut(length), floatsExpected(length);
+		std::vector<int> intsOne(length), intsTwo(length), intsOut(length), intsExpected(length);
+		for (int i = 0; i < length; i++)
+		{
+			floatsOne[i] = i * 0.37f;
+			floatsTwo[i] = 1000 - i * 1.3f;
+			intsOne[i] = i * 16;
+			intsTwo[i] = 5000 - i * 7;
+		}
+		int repeats = std::max(1, total / length);
+		double elements = (double)repeats * length * 2;
+
+		// The loops interpolateFrame ran before lerpSpan existed
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int r = 0; r < repeats; r++)
+		{
+			float ratio = (r & 63) / 64.0f;
+			for (int i = 0; i < length; i++)
+				floatsOut[i] = floatsOne[i] + (floatsTwo[i] - floatsOne[i]) * ratio;
+			for (int i = 0; i < length; i++)
+				intsOut[i] = intsOne[i] + (intsTwo[i] - intsOne[i]) * ratio;
+			sink = sink + floatsOut[0] + intsOut[0];
+		}
+		double loopNs = std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - start).count() / elements;
+		// Every step rounded to a float like the SIMD kernels do. A plain expression may be done in x87 extended precision
+		for (int i = 0; i < length; i++)
+		{
+			volatile float delta = floatsTwo[i] - floatsOne[i];
+			volatile float scaled = delta * 0.37f;
+			floatsExpected[i] = floatsOne[i] + scaled;
+			volatile float intDelta = (float)(intsTwo[i] - intsOne[i]);
+			volatile float intScaled = intDelta * 0.37f;
+			volatile float intSum = (float)intsOne[i] + intScaled;
+			intsExpected[i] = (int)intSum;
+		}
+
+		std::string results;
+		for (int kernel = 0; kernel < LerpSpanKernelCount; kernel++)
+		{
+			if (!setLerpSpanKernel((LerpSpanKernel)kernel))
+				continue;
+			start = std::chrono::high_resolution_clock::now();
+			for (int r = 0; r < repeats; r++)
+			{
+				float ratio = (r & 63) / 64.0f;
+				lerpSpan(floatsOne.data(), floatsTwo.data(), ratio, floatsOut.data(), length);
+				lerpSpan(intsOne.data(), intsTwo.data(), ratio, intsOut.data(), length);
+				sink = sink + floatsOut[0] + intsOut[0];
+			}
+			double kernelNs = std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - start).count() / elements;
+
+			lerpSpan(floatsOne.data(), floatsTwo.data(), 0.37f, floatsOut.data(), length);
+			lerpSpan(intsOne.data(), intsTwo.data(), 0.37f, intsOut.data(), length);
+			bool ok = floatsOut == floatsExpected && intsOut == intsExpected;
+			// The scalar kernel is allowed the last bit on x87, see LerpSpan.h
+			if (!ok && kernel == LerpSpanScalar)
+			{
+				ok = true;
+				for (int i = 0; i < length; i++)
+				{
+					ok &= fabsf(floatsOut[i] - floatsExpected[i]) <= fabsf(floatsExpected[i]) * FLT_EPSILON;
+					ok &= abs(intsOut[i] - intsExpected[i]) <= 1;
+				}
+			}
+
+			char result[96];
+			snprintf(result, sizeof(result), ", %s %.2f ns (%.1fx)%s", getLerpSpanKernelName((LerpSpanKernel)kernel), kernelNs, loopNs / kernelNs, ok ? "" : " MISMATCH");
+			results += result;
+		}
+		TGE::Con::printf("%4d elements: loop %.2f ns/element%s", length, loopNs, results.c_str());
+	}
+	setLerpSpanKernel(best);
+}
+
 //---------------------------------------------------------------------------------------
 // Extra Marble Physics Functions
 //It got too late when I figured that I could use ConsoleMethod instead for these functions and im too lazy to replace em.
@@ -923,5 +1340,10 @@ PLUGINCALLBACK void postEngineInit(PluginInterface *plugin)
 
 PLUGINCALLBACK void engineShutdown(PluginInterface *plugin)
 {
+	// Waits for a replay that's still being written
+	rewindManager.stopRecording();
+	// Lets a save state or an analysis that's still running finish first
+	workerThread.shutdown();
+	threadPool.shutdown();
 	stopLogging();
 }
\ No newline at end of file
@@ -1 +1,163 @@
 #include "WorkerThread.h"
+#include <algorithm>
+
+Worker::Worker()
+{
+    stopping = false;
+}
+
+Worker::~Worker()
+{
+    shutdown();
+}
+
+void Worker::start()
+{
+    // Called with the lock held
+    if (worker.joinable())
+        return;
+    stopping = false;
+    worker = std::thread(&Worker::run, this);
+}
+
+void Worker::run()
+{
+    while (true)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [this]() { return stopping || !tasks.empty(); });
+        if (tasks.empty())
+            return;
+        std::function<void()> task = std::move(tasks.front());
+        tasks.pop();
+        lock.unlock();
+        task();
+    }
+}
+
+void Worker::shutdown()
+{
+    mutex.lock();
+    stopping = true;
+    mutex.unlock();
+    wake.notify_all();
+    if (worker.joinable())
+        worker.join();
+}
+
+ThreadPool::ThreadPool()
+{
+    stopping = false;
+}
+
+ThreadPool::~ThreadPool()
+{
+    shutdown();
+}
+
+int ThreadPool::getThreadCount()
+{
+    unsigned int cores = std::thread::hardware_concurrency();
+    return cores > 1 ? cores : 2;
+}
+
+void ThreadPool::start()
+{
+    // Called with the lock held
+    if (!threads.empty())
+        return;
+    stopping = false;
+    for (int i = 0; i < getThreadCount() - 1; i++)
+        threads.push_back(std::thread(&ThreadPool::run, this));
+}
+
+void ThreadPool::run()
+{
+    while (true)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [this]() { return stopping || !tasks.empty(); });
+        if (tasks.empty())
+            return;
+        std::function<void()> task = std::move(tasks.front());
+        tasks.pop();
+        lock.unlock();
+        task();
+    }
+}
+
+void ThreadPool::addTask(std::function<void()> task)
+{
+    mutex.lock();
+    start();
+    tasks.push(std::move(task));
+    mutex.unlock();
+    wake.notify_one();
+}
+
+void ThreadPool::parallelFor(int count, std::function<void(int)> fn)
+{
+    if (count <= 0)
+        return;
+
+    // Shared with the tasks, which can still be sitting in the queue after every index has been handled
+    struct Job
+    {
+        std::function<void(int)> fn;
+        int count;
+        std::atomic<int> next;
+        std::atomic<int> done;
+        std::mutex mutex;
+        std::condition_variable finished;
+        std::exception_ptr error;
+    };
+    std::shared_ptr<Job> job = std::make_shared<Job>();
+    job->fn = std::move(fn);
+    job->count = count;
+    job->next = 0;
+    job->done = 0;
+
+    auto work = [job]()
+    {
+        int index;
+        while ((index = job->next++) < job->count)
+        {
+            try
+            {
+                job->fn(index);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(job->mutex);
+                if (!job->error)
+                    job->error = std::current_exception();
+            }
+            if (++job->done == job->count)
+            {
+                std::lock_guard<std::mutex> lock(job->mutex);
+                job->finished.notify_all();
+            }
+        }
+    };
+
+    int helpers = std::min(count, getThreadCount()) - 1;
+    for (int i = 0; i < helpers; i++)
+        addTask(work);
+    work();
+
+    std::unique_lock<std::mutex> lock(job->mutex);
+    job->finished.wait(lock, [&]() { return job->done == job->count; });
+    if (job->error)
+        std::rethrow_exception(job->error);
+}
+
+void ThreadPool::shutdown()
+{
+    mutex.lock();
+    stopping = true;
+    mutex.unlock();
+    wake.notify_all();
+    for (auto& thread : threads)
+        thread.join();
+    threads.clear();
+}
@@ -10,55 +10,75 @@
 #include <future>
 #include <functional>
 #include <stdexcept>
+#include <atomic>
 
 
+/*
+*   Runs tasks one after the other on a thread that stays around, in the order they were added.
+*   addTask hands back a future for the task's result, any exception it throws ends up in there too.
+*   The thread only gets started on first use.
+*/
 class Worker {
-    std::thread* worker;
+    std::thread worker;
     std::queue<std::function<void()>> tasks;
     std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping;
 
-public:
-    Worker()
-    {
-
-    }
+    void start();
+    void run();
 
-    ~Worker()
-    {
-        if (worker != NULL)
-        {
-            worker->join();
-            delete worker;
-        }
-    }
+public:
+    Worker();
+    ~Worker();
 
     template<class F>
-    void addTask(F&& f)
+    auto addTask(F&& f) -> std::future<decltype(f())>
     {
+        typedef decltype(f()) Result;
+        // packaged_task can't be copied into a std::function, so it gets shared instead
+        std::shared_ptr<std::packaged_task<Result()>> task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(f));
+        std::future<Result> result = task->get_future();
         mutex.lock();
-        tasks.push(f);
+        start();
+        tasks.push([task]() { (*task)(); });
         mutex.unlock();
-        if (tasks.size() != 0)
-        {
-            if (worker != NULL)
-            {
-                worker->join();
-                delete worker;
-            }
-            worker = new std::thread([=]()
-                {
-                    while (!tasks.empty()) {
-                        mutex.lock();
-                        std::function<void()> task = std::move(tasks.front());
-                        tasks.pop();
-                        mutex.unlock();
-                        task();
-                    }
-                });
-        }
+        wake.notify_one();
+        return result;
     }
 
+    // Finishes the queued tasks and stops the thread, it starts again if a task is added afterwards
+    void shutdown();
+};
+
+/*
+*   Fixed set of threads for work that splits into independent pieces, like replay chunks.
+*   Threads only get started on first use, so nothing is spawned while the plugin is being loaded.
+*/
+class ThreadPool {
+    std::vector<std::thread> threads;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping;
+
+    void start();
+    void run();
+
+public:
+    ThreadPool();
+    ~ThreadPool();
+
+    // Worker threads plus the calling thread, which always helps out in parallelFor
+    int getThreadCount();
+    void addTask(std::function<void()> task);
+    // Runs fn(0) to fn(count - 1) across the pool and returns once they're all done.
+    // The caller works through the indices too, so this can't stall behind other tasks. The first exception thrown gets rethrown here
+    void parallelFor(int count, std::function<void(int)> fn);
+    // Finishes the queued tasks and stops the threads, the pool starts them again if it's used afterwards
+    void shutdown();
 };
 
+extern ThreadPool threadPool;
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,153 @@
+#include "../RecordCursor.h"
+#include <cstdio>
+
+static int failures = 0;
+
+#define CHECK(x) do { if (!(x)) { printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #x); failures++; } } while (0)
+
+// A run of 30 recorded frames in blocks of 10, the way enforceHistoryBudget sees it
+static RecordCursor recordedRun()
+{
+	RecordCursor cursor;
+	cursor.recorded = 30;
+	return cursor;
+}
+
+static void testTruncateAfterDrop()
+{
+	RecordCursor cursor = recordedRun();
+	cursor.dropped(10);
+	int count = -1;
+	// Frames[5] is the recorder's frame 15
+	CHECK(cursor.unrecordFrom(5, &count) == RecordCursor::UnrecordTruncate);
+	CHECK(count == 15);
+	CHECK(cursor.recorded == 5);
+}
+
+static void testLoadStateAfterDrop()
+{
+	// loadState replaces Frames with the saved state, so the recorder has to forget the dropped frames too or the next save mixes both runs
+	RecordCursor cursor = recordedRun();
+	cursor.dropped(10);
+	CHECK(cursor.unrecordAll() == RecordCursor::UnrecordClear);
+	CHECK(cursor.recorded == 0);
+	CHECK(cursor.shift == 0);
+	CHECK(cursor.frontier == 0);
+	CHECK(cursor.isEmpty());
+}
+
+static void testLoadStateAfterDroppingEverythingRecorded()
+{
+	// Only the newest block is left and none of it has been recorded, the recorder still holds what got dropped
+	RecordCursor cursor = recordedRun();
+	cursor.dropped(30);
+	CHECK(cursor.recorded == 0);
+	CHECK(!cursor.isEmpty());
+	CHECK(cursor.unrecordAll() == RecordCursor::UnrecordClear);
+	CHECK(cursor.isEmpty());
+}
+
+static void testRewindEverythingAfterDrop()
+{
+	// Past the budget the oldest block went, rewinding all the way back still leaves it in the recording
+	RecordCursor cursor = recordedRun();
+	cursor.dropped(10);
+	int count = -1;
+	CHECK(cursor.unrecordFrom(0, &count) == RecordCursor::UnrecordTruncate);
+	CHECK(count == cursor.shift);
+	CHECK(count == 10);
+	CHECK(cursor.recorded == 0);
+	CHECK(!cursor.isEmpty());
+}
+
+static void testRewindEverythingWithoutDrop()
+{
+	// Nothing only the recorder has, starting over loses nothing
+	RecordCursor cursor = recordedRun();
+	int count = -1;
+	CHECK(cursor.unrecordFrom(0, &count) == RecordCursor::UnrecordClear);
+	CHECK(cursor.isEmpty());
+}
+
+static void testUnrecordFromEmpty()
+{
+	RecordCursor cursor;
+	int count = -1;
+	CHECK(cursor.unrecordFrom(0, &count) == RecordCursor::UnrecordNothing);
+	CHECK(cursor.unrecordFrom(3, &count) == RecordCursor::UnrecordNothing);
+}
+
+static void testUnrecordPastRecorded()
+{
+	RecordCursor cursor = recordedRun();
+	int count = -1;
+	CHECK(cursor.unrecordFrom(30, &count) == RecordCursor::UnrecordNothing);
+	CHECK(cursor.recorded == 30);
+}
+
+static void testRewindIntoThinnedHistory()
+{
+	RecordCursor cursor = recordedRun();
+	// The first block of 10 thinned down to 5
+	cursor.thinned(5, 5);
+	CHECK(cursor.frontier == 5);
+	int count = -1;
+	CHECK(cursor.unrecordFrom(10, &count) == RecordCursor::UnrecordTruncate);
+	CHECK(count == 15);
+	// Nothing was dropped off the front, only what's before Frames[3] for sure is kept
+	CHECK(cursor.unrecordFrom(3, &count) == RecordCursor::UnrecordTruncate);
+	CHECK(count == 3);
+	CHECK(cursor.recorded == 3);
+	// Recording carries on right after what was kept
+	CHECK(cursor.unrecordFrom(2, &count) == RecordCursor::UnrecordTruncate);
+	CHECK(count == 2);
+}
+
+static void testRewindIntoThinnedHistoryAfterDrop()
+{
+	// Blocks of 10: the first got dropped, the next thinned down to 5
+	RecordCursor cursor = recordedRun();
+	cursor.dropped(10);
+	cursor.thinned(5, 5);
+	CHECK(cursor.shift == 15);
+	int count = -1;
+	// Frames[2] is somewhere between the recorder's frame 12 and 17, the dropped block stays either way
+	CHECK(cursor.unrecordFrom(2, &count) == RecordCursor::UnrecordTruncate);
+	CHECK(count == 12);
+	CHECK(cursor.unrecordFrom(0, &count) == RecordCursor::UnrecordTruncate);
+	CHECK(count == 10);
+}
+
+static void testDropEveryThinnedBlock()
+{
+	RecordCursor cursor = recordedRun();
+	cursor.thinned(5, 5);
+	// The thinned block goes, what's left lines up with the recorder exactly again
+	cursor.dropped(5);
+	CHECK(cursor.frontier == 0);
+	CHECK(cursor.minShift == cursor.shift);
+	int count = -1;
+	CHECK(cursor.unrecordFrom(0, &count) == RecordCursor::UnrecordTruncate);
+	CHECK(count == 10);
+}
+
+int main()
+{
+	testTruncateAfterDrop();
+	testLoadStateAfterDrop();
+	testLoadStateAfterDroppingEverythingRecorded();
+	testUnrecordFromEmpty();
+	testUnrecordPastRecorded();
+	testRewindIntoThinnedHistory();
+	testRewindEverythingAfterDrop();
+	testRewindEverythingWithoutDrop();
+	testRewindIntoThinnedHistoryAfterDrop();
+	testDropEveryThinnedBlock();
+	if (failures != 0)
+	{
+		printf("%d checks failed\n", failures);
+		return 1;
+	}
+	printf("All checks passed\n");
+	return 0;
+}
@@ -0,0 +1,228 @@
+#include "../ReplayCodec.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <random>
+
+static int failures = 0;
+
+#define CHECK(x) do { if (!(x)) { printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #x); failures++; } } while (0)
+
+// Anything past outSize is a canary, a decoder that writes there overflowed the chunk
+#define CANARY_SIZE 64
+#define CANARY 0xA5
+
+static const ReplayCodec codecs[] = { { ReplayCodecRaw, 0 }, { ReplayCodecLZ, 0 }, { ReplayCodecZlib, -1 }, { ReplayCodecZlib, 1 } };
+
+static std::vector<uint8_t> compress(ReplayCodec codec, const std::vector<uint8_t>& data)
+{
+	std::vector<uint8_t> out(replayCompressBound(codec, data.size()));
+	uint8_t usedCodec;
+	out.resize(replayCompress(codec, data.data(), data.size(), out.data(), &usedCodec));
+	CHECK(usedCodec == codec.id);
+	return out;
+}
+
+static bool uncompressGuarded(uint8_t codec, const std::vector<uint8_t>& in, size_t outSize, std::vector<uint8_t>* out)
+{
+	out->assign(outSize + CANARY_SIZE, CANARY);
+	bool ok = replayUncompress(codec, in.data(), in.size(), out->data(), outSize);
+	for (size_t i = outSize; i < out->size(); i++)
+	{
+		if ((*out)[i] != CANARY)
+		{
+			printf("codec %d wrote past %zu bytes\n", codec, outSize);
+			failures++;
+			break;
+		}
+	}
+	out->resize(outSize);
+	return ok;
+}
+
+static void checkRoundTrip(const char* name, const std::vector<uint8_t>& data)
+{
+	for (auto& codec : codecs)
+	{
+		std::vector<uint8_t> compressed = compress(codec, data);
+		std::vector<uint8_t> out;
+		bool ok = uncompressGuarded(codec.id, compressed, data.size(), &out);
+		if (!ok || out != data)
+		{
+			printf("%s doesn't round trip through %s\n", name, getReplayCodecName(codec).c_str());
+			failures++;
+		}
+	}
+}
+
+static std::vector<uint8_t> randomBytes(std::mt19937& rng, size_t size, int alphabet)
+{
+	std::vector<uint8_t> data(size);
+	for (auto& byte : data)
+		byte = rng() % alphabet;
+	return data;
+}
+
+static void testRoundTrips()
+{
+	std::mt19937 rng(1);
+	checkRoundTrip("empty", std::vector<uint8_t>());
+	for (size_t size = 1; size < 20; size++)
+		checkRoundTrip("short", randomBytes(rng, size, 256));
+	checkRoundTrip("one byte repeated", std::vector<uint8_t>(100000, 7));
+	checkRoundTrip("random", randomBytes(rng, 100000, 256));
+	checkRoundTrip("few symbols", randomBytes(rng, 100000, 3));
+
+	// Literal and match lengths right around the 15 and 15 + 255 steps of the length encoding
+	for (size_t literals : { 14, 15, 16, 269, 270, 271, 600 })
+	{
+		for (size_t match : { 4, 18, 19, 20, 273, 274, 275, 1000 })
+		{
+			std::vector<uint8_t> data = randomBytes(rng, literals, 256);
+			std::vector<uint8_t> repeat(data.end() - std::min(literals, (size_t)8), data.end());
+			while (data.size() < literals + match)
+				data.insert(data.end(), repeat.begin(), repeat.end());
+			data.resize(literals + match);
+			checkRoundTrip("length steps", data);
+		}
+	}
+
+	// Matches as far back as an offset can reach, and just past it
+	for (size_t distance : { 0xFFFE, 0xFFFF, 0x10000 })
+	{
+		std::vector<uint8_t> data = randomBytes(rng, distance + 64, 256);
+		memcpy(&data[distance], &data[0], 64);
+		checkRoundTrip("far match", data);
+	}
+
+	// What chunks actually look like, frames that mostly repeat with a few changing fields
+	std::vector<uint8_t> frames;
+	for (int i = 0; i < 256; i++)
+	{
+		uint8_t frame[120] = {};
+		memcpy(frame, &i, sizeof(int));
+		frame[40 + i % 16] = rng();
+		frames.insert(frames.end(), frame, frame + sizeof(frame));
+	}
+	checkRoundTrip("frames", frames);
+}
+
+static void testWrongSize()
+{
+	std::mt19937 rng(2);
+	std::vector<uint8_t> data = randomBytes(rng, 5000, 4);
+	for (auto& codec : codecs)
+	{
+		std::vector<uint8_t> compressed = compress(codec, data);
+		std::vector<uint8_t> out;
+		CHECK(!uncompressGuarded(codec.id, compressed, data.size() - 1, &out));
+		CHECK(!uncompressGuarded(codec.id, compressed, data.size() + 1, &out));
+		CHECK(!uncompressGuarded(codec.id, compressed, 0, &out));
+	}
+}
+
+static void testUnknownCodec()
+{
+	std::vector<uint8_t> in(16, 0);
+	std::vector<uint8_t> out;
+	CHECK(!uncompressGuarded(3, in, 16, &out));
+	CHECK(!uncompressGuarded(255, in, 16, &out));
+}
+
+static void testTruncated()
+{
+	std::mt19937 rng(3);
+	std::vector<uint8_t> data = randomBytes(rng, 4000, 6);
+	for (auto& codec : codecs)
+	{
+		std::vector<uint8_t> compressed = compress(codec, data);
+		std::vector<uint8_t> out;
+		for (size_t size = 0; size < compressed.size(); size++)
+		{
+			std::vector<uint8_t> truncated(compressed.begin(), compressed.begin() + size);
+			CHECK(!uncompressGuarded(codec.id, truncated, data.size(), &out));
+		}
+	}
+}
+
+static void testMalformedLZ()
+{
+	std::vector<uint8_t> out;
+	// Match before the start of the output
+	CHECK(!uncompressGuarded(ReplayCodecLZ, { 0x10, 'a', 0x02, 0x00, 0x00 }, 5, &out));
+	// Offset 0
+	CHECK(!uncompressGuarded(ReplayCodecLZ, { 0x10, 'a', 0x00, 0x00, 0x00 }, 5, &out));
+	// Match running past the end of the output
+	CHECK(!uncompressGuarded(ReplayCodecLZ, { 0x1F, 'a', 0x01, 0x00, 0xFF, 0x00 }, 20, &out));
+	// Literals running past the end of the input and of the output
+	CHECK(!uncompressGuarded(ReplayCodecLZ, { 0x50, 'a', 'b' }, 5, &out));
+	CHECK(!uncompressGuarded(ReplayCodecLZ, { 0x30, 'a', 'b', 'c' }, 2, &out));
+	// Length bytes that never end
+	CHECK(!uncompressGuarded(ReplayCodecLZ, { 0xF0, 0xFF, 0xFF, 0xFF }, 1000, &out));
+	// Offset cut off
+	CHECK(!uncompressGuarded(ReplayCodecLZ, { 0x10, 'a', 0x01 }, 5, &out));
+	// Overlapping match is fine
+	CHECK(uncompressGuarded(ReplayCodecLZ, { 0x10, 'a', 0x01, 0x00, 0x00 }, 5, &out) && out == std::vector<uint8_t>(5, 'a'));
+}
+
+// Flipped, dropped and inserted bytes in real chunks, and plain garbage. They may decode or not but must never write out of bounds
+static void testFuzz()
+{
+	std::mt19937 rng(4);
+	std::vector<std::vector<uint8_t>> inputs = { randomBytes(rng, 3000, 3), randomBytes(rng, 3000, 256), std::vector<uint8_t>(3000, 1) };
+	for (auto& data : inputs)
+	{
+		for (auto& codec : codecs)
+		{
+			std::vector<uint8_t> compressed = compress(codec, data);
+			std::vector<uint8_t> out;
+			for (int i = 0; i < 3000; i++)
+			{
+				std::vector<uint8_t> mutated = compressed;
+				int edits = 1 + rng() % 4;
+				for (int j = 0; j < edits && mutated.size() != 0; j++)
+				{
+					size_t at = rng() % mutated.size();
+					switch (rng() % 3)
+					{
+					case 0:
+						mutated[at] ^= 1 << (rng() % 8);
+						break;
+					case 1:
+						mutated.erase(mutated.begin() + at);
+						break;
+					default:
+						mutated.insert(mutated.begin() + at, (uint8_t)rng());
+						break;
+					}
+				}
+				uncompressGuarded(codec.id, mutated, data.size(), &out);
+			}
+		}
+	}
+
+	for (int i = 0; i < 20000; i++)
+	{
+		std::vector<uint8_t> garbage = randomBytes(rng, rng() % 200, 256);
+		std::vector<uint8_t> out;
+		uncompressGuarded(ReplayCodecLZ, garbage, rng() % 2000, &out);
+		uncompressGuarded(ReplayCodecZlib, garbage, rng() % 2000, &out);
+	}
+}
+
+int main()
+{
+	testRoundTrips();
+	testWrongSize();
+	testUnknownCodec();
+	testTruncated();
+	testMalformedLZ();
+	testFuzz();
+	if (failures != 0)
+	{
+		printf("%d checks failed\n", failures);
+		return 1;
+	}
+	printf("All checks passed\n");
+	return 0;
+}